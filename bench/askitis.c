@@ -0,0 +1,183 @@
+//  judy_askitis: the string benchmark of Dr. Nikolas Askitis
+//  (www.naskitis.com), run against judy.c compiled with -DASKITIS,
+//  on corpora generated in memory instead of the distinct_1 and
+//  skew1_1 files of the original.
+
+//  usage:
+//  judy_askitis [distinct] [searches] [exponent]
+//  distinct    number of distinct strings to insert, default 1000000
+//  searches    number of strings to search for, default 10000000
+//  exponent    of the Zipf distribution the searches are drawn
+//              from, over the distinct strings, default 1.0
+
+//  As in the original, both phases count the instances of each
+//  string with judy_cell: the first fills the array with the
+//  distinct corpus, the second finds the skewed one in it.  The
+//  array's size is given as MaxMem, the bytes judy.c has taken
+//  from malloc, and as the growth of the resident set.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#  include <unistd.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+#include "judy.h"
+#include "bench.h"
+
+#define ASKITIS_maxlen 32       // longest generated string, with its newline
+
+unsigned int MaxMem = 0;
+unsigned long long Words = 0, Inserts = 0, Found = 0;
+
+//    resident set size in bytes; where /proc is not
+//    available, the peak resident set size instead
+
+static double rss( void ) {
+#ifdef __linux__
+    unsigned long size, resident = 0;
+    FILE * statm = fopen( "/proc/self/statm", "r" );
+
+    if( statm ) {
+        if( fscanf( statm, "%lu %lu", &size, &resident ) != 2 ) {
+            resident = 0;
+        }
+        fclose( statm );
+    }
+    return ( double )resident * sysconf( _SC_PAGESIZE );
+#else
+    struct rusage usage;
+
+    getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_maxrss * 1024.0;
+#endif
+}
+
+//    the distinct corpus: count newline-terminated strings, each
+//    a random lowercase prefix followed by its own index in decimal,
+//    so that no two are alike.  offsets[idx] is where string idx starts.
+
+static char * distinct_make( unsigned int count, unsigned int * offsets, unsigned int * size ) {
+    char * corpus = malloc( ( size_t )count * ASKITIS_maxlen );
+    unsigned int idx, len, off = 0, num;
+    uint64_t seed = 1;
+
+    if( !corpus ) {
+        return NULL;
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        offsets[idx] = off;
+        len = 1 + bench_rand( &seed ) % 12;
+        while( len-- ) {
+            corpus[off++] = 'a' + bench_rand( &seed ) % 26;
+        }
+        num = idx;
+        do {
+            corpus[off++] = '0' + num % 10;
+        } while( num /= 10 );
+        corpus[off++] = '\n';
+    }
+
+    *size = off;
+    return corpus;
+}
+
+//    the skewed corpus: count strings from the distinct corpus,
+//    drawn with Zipf-distributed frequencies.  which strings are
+//    the frequent ones is scattered over the distinct corpus.
+
+static char * skew_make( const char * distinct, const unsigned int * offsets, unsigned int words, unsigned int count, double exponent, unsigned int * size ) {
+    char * corpus = malloc( ( size_t )count * ASKITIS_maxlen );
+    double * cdf = bench_zipf_table( words, exponent );
+    unsigned int idx, off = 0, len;
+    uint64_t seed = 2, rank;
+    const char * word;
+
+    if( !corpus || !cdf ) {
+        return NULL;
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        rank = bench_zipf( cdf, words, &seed );
+        word = distinct + offsets[bench_rand( &rank ) % words];
+        len = strchr( word, '\n' ) - word + 1;
+        memcpy( corpus + off, word, len );
+        off += len;
+    }
+
+    free( cdf );
+    *size = off;
+    return corpus;
+}
+
+//    count each newline-terminated string of corpus in judy
+
+static double askitis_load( Judy * judy, const char * corpus, unsigned int size ) {
+    unsigned int off, prev = 0;
+    double start = bench_now();
+
+    for( off = 0; off < size; off++ )
+        if( corpus[off] == '\n' ) {
+            *( judy_cell( judy, ( const unsigned char * )corpus + prev, off - prev ) ) += 1;   // count instances of string
+            prev = off + 1;
+        }
+
+    return ( bench_now() - start ) / 1e9;
+}
+
+static void askitis_report( const char * phase, double seconds, double before ) {
+    fprintf( stderr, "%-20s %.2f MB\n", "Judy Array size:", MaxMem / 1000000. );
+    fprintf( stderr, "%-20s %.2f MB\n", "RSS growth:", ( rss() - before ) / 1000000. );
+    fprintf( stderr, "Time to %-12s %.3f sec\n", phase, seconds );
+    fprintf( stderr, "%-20s %llu\n", "Words:", Words );
+    fprintf( stderr, "%-20s %llu\n", "Inserts:", Inserts );
+    fprintf( stderr, "%-20s %llu\n", "Found:", Found );
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int words = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    unsigned int searches = argc > 2 ? strtoul( argv[2], NULL, 10 ) : 10000000;
+    double exponent = argc > 3 ? atof( argv[3] ) : 1.0;
+    unsigned int * offsets, distinctSize, skewSize;
+    char * distinct, *skew;
+    double before, seconds;
+    Judy * judy;
+
+    if( !words || !searches || exponent < 0 ) {
+        fprintf( stderr, "usage: %s [distinct] [searches] [exponent]\n", argv[0] );
+        return 1;
+    }
+
+    if( !( offsets = malloc( words * sizeof( *offsets ) ) ) || !( distinct = distinct_make( words, offsets, &distinctSize ) )
+            || !( skew = skew_make( distinct, offsets, words, searches, exponent, &skewSize ) ) ) {
+        fprintf( stderr, "out of memory for the corpora\n" );
+        return 1;
+    }
+
+    free( offsets );
+    fprintf( stderr, "JudyArray@Karl_Malbrain\nDASKITIS option enabled\n-------------------------------\n" );
+    fprintf( stderr, "%u distinct strings, %.1f MB; %u searches, %.1f MB, Zipf exponent %.2f\n\n",
+             words, distinctSize / 1000000., searches, skewSize / 1000000., exponent );
+
+    before = rss();
+    judy = judy_open( 1024, 0 );
+
+    seconds = askitis_load( judy, distinct, distinctSize );
+    askitis_report( "insert:", seconds, before );
+
+    Words = Inserts = Found = 0;
+
+    seconds = askitis_load( judy, skew, skewSize );
+    fprintf( stderr, "\n" );
+    askitis_report( "search:", seconds, before );
+
+    judy_close( judy );
+    free( distinct );
+    free( skew );
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef JUDY_BENCH_H
+#define JUDY_BENCH_H
+
+//  helpers shared by the benchmarks in this directory:
+//  a monotonic clock, and a small, fast, seedable random
+//  number generator and Zipf sampler, so that every run
+//  sees the same keys.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+/// nanoseconds from a monotonic clock
+static inline double bench_now( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// splitmix64: the next pseudo-random value from state
+static inline uint64_t bench_rand( uint64_t * state ) {
+    uint64_t z = ( *state += 0x9e3779b97f4a7c15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+/// cumulative Zipf distribution over n ranks with exponent s, for bench_zipf; free() it
+static inline double * bench_zipf_table( unsigned int n, double s ) {
+    double * cdf = ( double * )malloc( n * sizeof( double ) );
+    double sum = 0;
+    unsigned int idx;
+
+    if( !cdf ) {
+        return NULL;
+    }
+
+    for( idx = 0; idx < n; idx++ ) {
+        cdf[idx] = sum += 1.0 / pow( idx + 1.0, s );
+    }
+
+    for( idx = 0; idx < n; idx++ ) {
+        cdf[idx] /= sum;
+    }
+
+    return cdf;
+}
+
+/// a rank from 0 to n - 1, rank 0 the most frequent
+static inline unsigned int bench_zipf( const double * cdf, unsigned int n, uint64_t * state ) {
+    double u = ( bench_rand( state ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+    unsigned int low = 0, high = n - 1, mid;
+
+    while( low < high ) {
+        mid = low + ( high - low ) / 2;
+        if( cdf[mid] < u ) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+#endif //JUDY_BENCH_H
@@ -0,0 +1,314 @@
+//  judy_bench: time and hardware counters per operation for each
+//  phase of a judy array's life - insert, lookup of present keys,
+//  lookup of absent keys, in-order scan and delete - so that node
+//  layouts can be tuned by their cache, TLB and branch behaviour.
+
+//  usage:
+//  judy_bench [count] [random|sequential|string]
+//  count defaults to 1000000 keys, the distribution to random
+//  64-bit integers.
+
+//  With -DJUDY_INSTRUMENT, the cache lines of linear nodes each
+//  operation read are counted too (see JudyCounters in judy.h).
+
+//  On linux the counters are read with perf_event_open, as one
+//  group so that all of them cover the same interval; counts are
+//  scaled up if the kernel had to multiplex the group.  Where perf
+//  events are not permitted (see /proc/sys/kernel/perf_event_paranoid)
+//  or not supported, only times are reported.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#endif
+
+#include "judy.h"
+#include "bench.h"
+
+#define BENCH_events  6
+#define BENCH_strlen  24    // string keys are up to 23 bytes
+
+typedef struct {
+    const char * name;
+    unsigned int type;
+    unsigned long long config;
+} BenchEvent;
+
+#ifdef __linux__
+#define BENCH_cache( cache ) ( ( cache ) | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 )
+
+static const BenchEvent Events[BENCH_events] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instrs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "L1d-miss", PERF_TYPE_HW_CACHE, BENCH_cache( PERF_COUNT_HW_CACHE_L1D ) },
+    { "LLC-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "dTLB-miss", PERF_TYPE_HW_CACHE, BENCH_cache( PERF_COUNT_HW_CACHE_DTLB ) },
+    { "br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+#endif
+
+typedef struct {
+    int leader;                     // group leader, or -1 for times only
+    unsigned int count;             // number of events in the group
+    int events[BENCH_events];       // index into Events of each, in group order
+    double start;                   // time the phase started
+#ifdef JUDY_INSTRUMENT
+    Judy * judy;                    // whose linear node cache lines are counted
+    unsigned long long lines;       // judy->counters.lines when the phase started
+#endif
+} BenchCounters;
+
+typedef struct {
+    unsigned char * keys;           // count keys, each width bytes
+    unsigned int count;
+    unsigned int width;
+    unsigned int depth;             // judy_open depth: 1 for integer keys, 0 for strings
+} BenchKeys;
+
+//    open as many of the events as the kernel allows,
+//    as one group led by the first of them.
+
+static void counters_open( BenchCounters * c ) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    unsigned int idx;
+    int fd, err = 0;
+
+    c->leader = -1;
+    c->count = 0;
+
+    for( idx = 0; idx < BENCH_events; idx++ ) {
+        memset( &attr, 0, sizeof( attr ) );
+        attr.size = sizeof( attr );
+        attr.type = Events[idx].type;
+        attr.config = Events[idx].config;
+        attr.disabled = c->leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        if( ( fd = syscall( __NR_perf_event_open, &attr, 0, -1, c->leader, 0 ) ) < 0 ) {
+            if( !err ) {
+                err = errno;
+            }
+            continue;
+        }
+
+        if( c->leader < 0 ) {
+            c->leader = fd;
+        }
+        c->events[c->count++] = idx;
+    }
+
+    if( c->leader < 0 ) {
+        fprintf( stderr, "perf events not available (%s), reporting times only\n", strerror( err ) );
+    }
+#else
+    c->leader = -1;
+    c->count = 0;
+    fprintf( stderr, "perf events not available on this platform, reporting times only\n" );
+#endif
+}
+
+static void counters_header( BenchCounters * c ) {
+#ifdef __linux__
+    unsigned int idx;
+#endif
+
+    printf( "%-12s %10s", "phase", "ns/op" );
+#ifdef JUDY_INSTRUMENT
+    printf( " %10s", "lines" );
+#endif
+#ifdef __linux__
+    for( idx = 0; idx < c->count; idx++ ) {
+        printf( " %10s", Events[c->events[idx]].name );
+    }
+#else
+    ( void )c;
+#endif
+    printf( "\n" );
+}
+
+static void counters_start( BenchCounters * c ) {
+#ifdef __linux__
+    if( c->leader >= 0 ) {
+        ioctl( c->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+        ioctl( c->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+    }
+#endif
+#ifdef JUDY_INSTRUMENT
+    c->lines = c->judy->counters.lines;
+#endif
+    c->start = bench_now();
+}
+
+//    stop the counters and print them, divided by ops
+
+static void counters_stop( BenchCounters * c, const char * phase, unsigned int ops ) {
+    double elapsed = bench_now() - c->start;
+#ifdef __linux__
+    uint64_t buff[3 + BENCH_events];    // nr, time enabled, time running, values
+    unsigned int idx;
+
+    if( c->leader >= 0 ) {
+        ioctl( c->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+    }
+#endif
+
+    if( !ops ) {
+        ops = 1;
+    }
+
+    printf( "%-12s %10.1f", phase, elapsed / ops );
+#ifdef JUDY_INSTRUMENT
+    printf( " %10.2f", ( double )( c->judy->counters.lines - c->lines ) / ops );
+#endif
+#ifdef __linux__
+    if( c->leader >= 0 && read( c->leader, buff, sizeof( buff ) ) > 0 ) {
+        for( idx = 0; idx < c->count; idx++ ) {
+            if( buff[2] ) {
+                printf( " %10.2f", ( double )buff[3 + idx] * buff[1] / buff[2] / ops );
+            } else {
+                printf( " %10s", "-" );   // the group was never scheduled
+            }
+        }
+    }
+#endif
+    printf( "\n" );
+}
+
+//    generate count keys of the given distribution from seed
+
+static void keys_make( BenchKeys * k, const char * kind, unsigned int count, uint64_t seed, int absent ) {
+    unsigned int idx, len, i;
+    JudySlot key;
+
+    k->count = count;
+    k->depth = strcmp( kind, "string" ) ? 1 : 0;
+    k->width = k->depth ? sizeof( JudySlot ) : BENCH_strlen;
+
+    if( !( k->keys = malloc( ( size_t )count * k->width ) ) ) {
+        fprintf( stderr, "out of memory for %u keys\n", count );
+        exit( 1 );
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        if( !k->depth ) {
+            len = 4 + bench_rand( &seed ) % ( BENCH_strlen - 5 );
+            for( i = 0; i < len; i++ ) {
+                k->keys[idx * k->width + i] = 'a' + bench_rand( &seed ) % 26;
+            }
+            k->keys[idx * k->width + len] = 0;
+            continue;
+        }
+
+        if( !strcmp( kind, "sequential" ) ) {
+            key = ( JudySlot )idx * 2 + absent;     // absent keys fall between the present ones
+        } else {
+            key = ( JudySlot )bench_rand( &seed );
+        }
+        memcpy( k->keys + idx * k->width, &key, sizeof( key ) );
+    }
+}
+
+static unsigned char * keys_get( BenchKeys * k, unsigned int idx, unsigned int * len ) {
+    unsigned char * key = k->keys + ( size_t )idx * k->width;
+
+    *len = k->depth ? JUDY_key_size : strlen( ( char * )key );
+    return key;
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    const char * kind = argc > 2 ? argv[2] : "random";
+    unsigned int idx, len, found, scanned, deleted;
+    BenchKeys present, absent;
+    BenchCounters counters;
+    unsigned char * key;
+    JudySlot * cell;
+    Judy * judy;
+
+    if( !count || ( strcmp( kind, "random" ) && strcmp( kind, "sequential" ) && strcmp( kind, "string" ) ) ) {
+        fprintf( stderr, "usage: %s [count] [random|sequential|string]\n", argv[0] );
+        return 1;
+    }
+
+    keys_make( &present, kind, count, 1, 0 );
+    keys_make( &absent, kind, count, 2, 1 );
+
+    if( !( judy = judy_open( present.depth ? JUDY_key_size : BENCH_strlen, present.depth ) ) ) {
+        fprintf( stderr, "judy_open failed\n" );
+        return 1;
+    }
+
+    printf( "judy_bench: %u %s keys\n", count, kind );
+    counters_open( &counters );
+#ifdef JUDY_INSTRUMENT
+    counters.judy = judy;
+#endif
+    counters_header( &counters );
+
+    counters_start( &counters );
+    for( idx = 0; idx < count; idx++ ) {
+        key = keys_get( &present, idx, &len );
+        if( ( cell = judy_cell( judy, key, len ) ) ) {
+            *cell = idx + 1;
+        }
+    }
+    counters_stop( &counters, "insert", count );
+
+    counters_start( &counters );
+    for( found = idx = 0; idx < count; idx++ ) {
+        key = keys_get( &present, idx, &len );
+        if( ( cell = judy_get( judy, key, len ) ) && *cell ) {
+            found++;
+        }
+    }
+    counters_stop( &counters, "lookup-hit", count );
+
+    if( found != count ) {
+        fprintf( stderr, "lookup-hit: %u of %u keys found\n", found, count );
+        return 1;
+    }
+
+    counters_start( &counters );
+    for( found = idx = 0; idx < count; idx++ ) {
+        key = keys_get( &absent, idx, &len );
+        if( ( cell = judy_get( judy, key, len ) ) && *cell ) {
+            found++;
+        }
+    }
+    counters_stop( &counters, "lookup-miss", count );
+
+    counters_start( &counters );
+    for( scanned = 0, cell = judy_strt( judy, NULL, 0 ); cell; cell = judy_nxt( judy ) ) {
+        scanned++;
+    }
+    counters_stop( &counters, "scan", scanned );
+
+    counters_start( &counters );
+    for( deleted = idx = 0; idx < count; idx++ ) {
+        key = keys_get( &present, idx, &len );
+        if( judy_slot( judy, key, len ) ) {
+            judy_del( judy );
+            deleted++;
+        }
+    }
+    counters_stop( &counters, "delete", count );
+
+    //  random keys may repeat, and absent ones may be present
+
+    printf( "%u distinct keys, %u absent keys found, %u deleted\n", scanned, found, deleted );
+
+    judy_close( judy );
+    free( present.keys );
+    free( absent.keys );
+    return 0;
+}
@@ -0,0 +1,268 @@
+//  judy_compare: insert and lookup throughput, and memory per key, of
+//  judyLArray, judyL2Array and judySArray against std::map and
+//  std::unordered_map, over key distributions generated from a fixed
+//  seed. Results go to stdout as JSON, so that they can be kept and
+//  compared between commits; progress goes to stderr.
+
+//  usage:
+//  judy_compare [count]
+//  count defaults to 1000000 keys per distribution.
+
+//  Memory is the growth of the C heap (mallinfo2, glibc 2.33 and
+//  later) while the container is filled, so it includes the nodes
+//  of the std containers and the strings they own; it is null where
+//  mallinfo2 is not available.
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#ifdef HAVE_STD_ENABLEIF
+#  include <unordered_map>
+#endif
+
+#if defined(__GLIBC__)
+#  include <malloc.h>
+#  if __GLIBC_PREREQ(2, 33)
+#    define BENCH_MALLINFO
+#  endif
+#endif
+
+#include "judyLArray.h"
+#include "judyL2Array.h"
+#include "judySArray.h"
+#include "bench.h"
+
+/// bytes allocated from the C heap, or 0 if unknown
+static size_t heapBytes() {
+#ifdef BENCH_MALLINFO
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+/// the keys of one distribution, in the order they are inserted and looked up
+struct workload {
+    const char * name;
+    std::vector< uint64_t > ints;
+    std::vector< std::string > strs;
+    size_t distinct;
+};
+
+struct result {
+    double insertMops, lookupMops, bytesPerKey;
+};
+
+/// judyLArray< uint64_t, uint64_t >
+struct judyLAdapter {
+    typedef judyLArray< uint64_t, uint64_t > map;
+    typedef uint64_t key;
+    static map * make() {
+        return new map;
+    }
+    static void insert( map & m, const key & k, uint64_t v ) {
+        m.insert( k, v );
+    }
+    static bool find( map & m, const key & k ) {
+        return m.findPtr( k ) != 0;
+    }
+};
+
+/// judyL2Array< uint64_t, uint64_t >; repeated keys collect their values
+struct judyL2Adapter {
+    typedef judyL2Array< uint64_t, uint64_t > map;
+    typedef uint64_t key;
+    static map * make() {
+        return new map;
+    }
+    static void insert( map & m, const key & k, uint64_t v ) {
+        m.insert( k, v );
+    }
+    static bool find( map & m, const key & k ) {
+        return m.find( k ) != 0;
+    }
+};
+
+/// judySArray< uint64_t >
+struct judySAdapter {
+    typedef judySArray< uint64_t > map;
+    typedef std::string key;
+    static map * make() {
+        return new map( 256 );
+    }
+    static void insert( map & m, const key & k, uint64_t v ) {
+        m.insert( k.c_str(), v, k.size() );
+    }
+    static bool find( map & m, const key & k ) {
+        return m.findPtr( k.c_str(), k.size() ) != 0;
+    }
+};
+
+/// std::map, std::unordered_map
+template< typename stdMap >
+struct stdAdapter {
+    typedef stdMap map;
+    typedef typename stdMap::key_type key;
+    static map * make() {
+        return new map;
+    }
+    static void insert( map & m, const key & k, uint64_t v ) {
+        m[k] = v;
+    }
+    static bool find( map & m, const key & k ) {
+        return m.find( k ) != m.end();
+    }
+};
+
+/// fill a container with keys, then look each of them up
+template< typename adapter >
+result run( const std::vector< typename adapter::key > & keys, size_t distinct ) {
+    result r;
+    size_t before = heapBytes(), hits = 0, idx;
+    typename adapter::map * m = adapter::make();
+    double start = bench_now();
+
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        adapter::insert( *m, keys[idx], idx + 1 );
+    }
+
+    double mid = bench_now();
+    r.bytesPerKey = before ? ( double )( heapBytes() - before ) / distinct : -1;
+
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        hits += adapter::find( *m, keys[idx] );
+    }
+
+    double stop = bench_now();
+    delete m;
+
+    if( hits != keys.size() ) {
+        fprintf( stderr, "judy_compare: %lu of %lu keys found\n", ( unsigned long )hits, ( unsigned long )keys.size() );
+        exit( EXIT_FAILURE );
+    }
+
+    r.insertMops = keys.size() * 1e3 / ( mid - start );
+    r.lookupMops = keys.size() * 1e3 / ( stop - mid );
+    return r;
+}
+
+static bool firstResult = true;
+
+void report( const workload & w, const char * container, const result & r ) {
+    fprintf( stderr, "%-12s %-20s insert %7.2f Mops/s  lookup %7.2f Mops/s  %7.1f bytes/key\n",
+             w.name, container, r.insertMops, r.lookupMops, r.bytesPerKey );
+    printf( "%s\n    { \"distribution\": \"%s\", \"container\": \"%s\", \"insert_mops\": %.3f, \"lookup_mops\": %.3f, ",
+            firstResult ? "" : ",", w.name, container, r.insertMops, r.lookupMops );
+    if( r.bytesPerKey < 0 ) {
+        printf( "\"bytes_per_key\": null }" );
+    } else {
+        printf( "\"bytes_per_key\": %.2f }", r.bytesPerKey );
+    }
+    firstResult = false;
+}
+
+/// a random lowercase string of min to max characters
+std::string randomString( uint64_t * seed, unsigned int min, unsigned int max ) {
+    std::string s( min + bench_rand( seed ) % ( max - min + 1 ), 'a' );
+    for( size_t i = 0; i < s.size(); i++ ) {
+        s[i] = 'a' + bench_rand( seed ) % 26;
+    }
+    return s;
+}
+
+std::vector< workload > makeWorkloads( unsigned int count ) {
+    std::vector< workload > all( 6 );
+    uint64_t seed = 1, base = 0;
+    unsigned int idx;
+    char buff[256];
+
+    all[0].name = "sequential";
+    all[1].name = "random";
+    all[2].name = "clustered";
+    all[3].name = "zipf";
+    all[4].name = "short-string";
+    all[5].name = "long-string";
+
+    for( idx = 0; idx < count; idx++ ) {
+        all[0].ints.push_back( idx + 1 );
+        all[1].ints.push_back( bench_rand( &seed ) );
+    }
+
+    //  runs of 256 keys, each within 64K of a random base
+
+    for( idx = 0; idx < count; idx++ ) {
+        if( !( idx % 256 ) ) {
+            base = bench_rand( &seed ) & ~( uint64_t )0xffff;
+        }
+        all[2].ints.push_back( base + ( bench_rand( &seed ) & 0xffff ) );
+    }
+
+    //  Zipf-distributed ranks, scattered over the key space
+
+    double * cdf = bench_zipf_table( count, 0.99 );
+    for( idx = 0; idx < count; idx++ ) {
+        uint64_t rank = bench_zipf( cdf, count, &seed );
+        all[3].ints.push_back( bench_rand( &rank ) );
+    }
+    free( cdf );
+
+    //  short words, and URLs sharing a few hundred host names
+
+    for( idx = 0; idx < count; idx++ ) {
+        all[4].strs.push_back( randomString( &seed, 4, 12 ) );
+        uint64_t host = bench_rand( &seed ) % 500;
+        sprintf( buff, "https://www.host%u.example.com/", ( unsigned int )host );
+        all[5].strs.push_back( buff + randomString( &seed, 8, 24 ) + "/" + randomString( &seed, 8, 40 ) + ".html" );
+    }
+
+    for( idx = 0; idx < all.size(); idx++ ) {
+        if( all[idx].ints.size() ) {
+            std::vector< uint64_t > keys( all[idx].ints );
+            std::sort( keys.begin(), keys.end() );
+            all[idx].distinct = std::unique( keys.begin(), keys.end() ) - keys.begin();
+        } else {
+            std::vector< std::string > keys( all[idx].strs );
+            std::sort( keys.begin(), keys.end() );
+            all[idx].distinct = std::unique( keys.begin(), keys.end() ) - keys.begin();
+        }
+    }
+
+    return all;
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+
+    if( !count ) {
+        fprintf( stderr, "usage: %s [count]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    std::vector< workload > all = makeWorkloads( count );
+
+    printf( "{\n  \"benchmark\": \"judy_compare\",\n  \"keys\": %u,\n  \"results\": [", count );
+
+    for( size_t idx = 0; idx < all.size(); idx++ ) {
+        const workload & w = all[idx];
+        if( w.ints.size() ) {
+            report( w, "judyLArray", run< judyLAdapter >( w.ints, w.distinct ) );
+            report( w, "judyL2Array", run< judyL2Adapter >( w.ints, w.distinct ) );
+            report( w, "std::map", run< stdAdapter< std::map< uint64_t, uint64_t > > >( w.ints, w.distinct ) );
+#ifdef HAVE_STD_ENABLEIF
+            report( w, "std::unordered_map", run< stdAdapter< std::unordered_map< uint64_t, uint64_t > > >( w.ints, w.distinct ) );
+#endif
+        } else {
+            report( w, "judySArray", run< judySAdapter >( w.strs, w.distinct ) );
+            report( w, "std::map", run< stdAdapter< std::map< std::string, uint64_t > > >( w.strs, w.distinct ) );
+#ifdef HAVE_STD_ENABLEIF
+            report( w, "std::unordered_map", run< stdAdapter< std::unordered_map< std::string, uint64_t > > >( w.strs, w.distinct ) );
+#endif
+        }
+    }
+
+    printf( "\n  ]\n}\n" );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,312 @@
+//  judy_latency: the time of every single insert, lookup and delete,
+//  kept in log-linear histograms, to show the tail that per-phase
+//  averages hide: the occasional judy_promote copy, judy_splitnode
+//  building a radix node, or malloc of a new segment.
+
+//  usage:
+//  judy_latency [count] [random|sequential|string]
+//  count defaults to 1000000 keys, the distribution to random
+//  64-bit integers.
+
+//  judy.c is compiled into this benchmark with -DJUDY_INSTRUMENT, and
+//  the structural event counters are compared before and after each
+//  insert and delete, so that each operation is filed under the most
+//  expensive event it caused.  For each operation, and each event,
+//  p50, p99, p99.9 and the maximum are reported, with the share of
+//  the operations slower than the operation's p99.9 that each event
+//  accounts for.
+
+//  Each time includes one read of the monotonic clock, whose cost
+//  is measured first and reported as "clock".
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "judy.h"
+#include "bench.h"
+
+#ifndef JUDY_INSTRUMENT
+#  error judy_latency needs judy.c and judy.h compiled with -DJUDY_INSTRUMENT
+#endif
+
+#define LATENCY_sub     32      // buckets per power of two: within 1/32 of the value
+#define LATENCY_buckets ( ( 64 - 4 ) * LATENCY_sub )
+#define LATENCY_strlen  24      // string keys are up to 23 bytes
+
+//    the events an operation is filed under, cheapest first;
+//    an operation causing several is filed under the last
+
+enum {
+    EVENT_none,
+    EVENT_reuse,        // a node taken from a reuse list
+    EVENT_carve,        // a node carved from the current segment
+    EVENT_demote,
+    EVENT_collapse,
+    EVENT_promote,
+    EVENT_splitspan,
+    EVENT_flatten,      // a radix node made flat
+    EVENT_splitnode,
+    EVENT_segment,      // a new segment malloc'ed
+    EVENT_max
+};
+
+static const char * EventNames[EVENT_max] = {
+    "none", "reuse", "carve", "demote", "collapse", "promote", "splitspan", "flatten", "splitnode", "segment"
+};
+
+typedef struct {
+    unsigned long long counts[LATENCY_buckets];
+    unsigned long long total;
+    unsigned long long max;
+} Histogram;
+
+typedef struct {
+    Histogram all;
+    Histogram events[EVENT_max];
+} OpLatency;
+
+//    bucket of a value: exact below 2 * LATENCY_sub,
+//    then LATENCY_sub buckets per power of two
+
+static unsigned int bucket_of( unsigned long long value ) {
+    unsigned int exp = 0;
+
+    if( value < 2 * LATENCY_sub ) {
+        return ( unsigned int )value;
+    }
+
+    while( value >> exp >= 2 * LATENCY_sub ) {
+        exp++;
+    }
+
+    return ( exp + 1 ) * LATENCY_sub + ( unsigned int )( value >> exp ) - 2 * LATENCY_sub;
+}
+
+//    the largest value filed in a bucket
+
+static unsigned long long bucket_top( unsigned int bucket ) {
+    unsigned int exp;
+
+    if( bucket < 2 * LATENCY_sub ) {
+        return bucket;
+    }
+
+    exp = bucket / LATENCY_sub - 1;
+    return ( ( unsigned long long )( bucket % LATENCY_sub + LATENCY_sub + 1 ) << exp ) - 1;
+}
+
+static void histogram_add( Histogram * h, unsigned long long value ) {
+    h->counts[bucket_of( value )]++;
+    h->total++;
+
+    if( value > h->max ) {
+        h->max = value;
+    }
+}
+
+//    the value below which fraction of the entries fall
+
+static unsigned long long histogram_at( const Histogram * h, double fraction ) {
+    unsigned long long seen = 0, want = ( unsigned long long )( fraction * h->total + 0.5 );
+    unsigned int bucket;
+
+    for( bucket = 0; bucket < LATENCY_buckets; bucket++ )
+        if( ( seen += h->counts[bucket] ) >= want && seen ) {
+            return bucket_top( bucket ) < h->max ? bucket_top( bucket ) : h->max;
+        }
+
+    return h->max;
+}
+
+//    entries in buckets whose values may exceed limit
+
+static unsigned long long histogram_above( const Histogram * h, unsigned long long limit ) {
+    unsigned long long above = 0;
+    unsigned int bucket;
+
+    for( bucket = bucket_of( limit ) + 1; bucket < LATENCY_buckets; bucket++ ) {
+        above += h->counts[bucket];
+    }
+
+    return above;
+}
+
+//    the most expensive event between two snapshots of the counters
+
+static int event_of( const JudyCounters * before, const JudyCounters * after ) {
+    unsigned long long promotes = 0;
+    int type;
+
+    for( type = 0; type < 8; type++ ) {
+        promotes += after->promotes[type] - before->promotes[type];
+    }
+
+    if( after->segments != before->segments ) {
+        return EVENT_segment;
+    }
+    if( after->splitnodes != before->splitnodes ) {
+        return EVENT_splitnode;
+    }
+    if( after->flattens != before->flattens ) {
+        return EVENT_flatten;
+    }
+    if( after->splitspans != before->splitspans ) {
+        return EVENT_splitspan;
+    }
+    if( promotes ) {
+        return EVENT_promote;
+    }
+    if( after->collapses != before->collapses ) {
+        return EVENT_collapse;
+    }
+    if( after->demotes != before->demotes ) {
+        return EVENT_demote;
+    }
+    if( after->reuseMisses != before->reuseMisses ) {
+        return EVENT_carve;
+    }
+    if( after->reuseHits != before->reuseHits ) {
+        return EVENT_reuse;
+    }
+    return EVENT_none;
+}
+
+static void latency_add( OpLatency * op, unsigned long long ns, int event ) {
+    histogram_add( &op->all, ns );
+    histogram_add( &op->events[event], ns );
+}
+
+static void latency_print( const char * name, const OpLatency * op ) {
+    unsigned long long tail = histogram_at( &op->all, 0.999 ), above = histogram_above( &op->all, tail );
+    const Histogram * h;
+    int event;
+
+    printf( "%-14s %10llu %8llu %8llu %8llu %10llu\n", name, op->all.total,
+            histogram_at( &op->all, 0.5 ), histogram_at( &op->all, 0.99 ), tail, op->all.max );
+
+    for( event = 0; event < EVENT_max; event++ ) {
+        if( !( h = op->events + event )->total || h->total == op->all.total ) {
+            continue;
+        }
+
+        printf( "  %-12s %10llu %8llu %8llu %8llu %10llu %9.1f%%\n", EventNames[event], h->total,
+                histogram_at( h, 0.5 ), histogram_at( h, 0.99 ), histogram_at( h, 0.999 ), h->max,
+                above ? 100.0 * histogram_above( h, tail ) / above : 0.0 );
+    }
+}
+
+//    generate count keys of the given distribution from seed
+
+static unsigned char * keys_make( const char * kind, unsigned int count, uint64_t seed, unsigned int width ) {
+    unsigned char * keys = malloc( ( size_t )count * width );
+    unsigned int idx, len, i;
+    JudySlot key;
+
+    if( !keys ) {
+        fprintf( stderr, "out of memory for %u keys\n", count );
+        exit( 1 );
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        if( !strcmp( kind, "string" ) ) {
+            len = 4 + bench_rand( &seed ) % ( LATENCY_strlen - 5 );
+            for( i = 0; i < len; i++ ) {
+                keys[idx * width + i] = 'a' + bench_rand( &seed ) % 26;
+            }
+            keys[idx * width + len] = 0;
+            continue;
+        }
+
+        if( !strcmp( kind, "sequential" ) ) {
+            key = idx;
+        } else {
+            key = ( JudySlot )bench_rand( &seed );
+        }
+        memcpy( keys + idx * width, &key, sizeof( key ) );
+    }
+
+    return keys;
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    const char * kind = argc > 2 ? argv[2] : "random";
+    OpLatency * insert, *lookup, *delete;
+    unsigned int idx, len, depth, width;
+    double start, overhead = 0;
+    JudyCounters before;
+    unsigned char * keys, *key;
+    JudySlot * cell;
+    Judy * judy;
+
+    if( !count || ( strcmp( kind, "random" ) && strcmp( kind, "sequential" ) && strcmp( kind, "string" ) ) ) {
+        fprintf( stderr, "usage: %s [count] [random|sequential|string]\n", argv[0] );
+        return 1;
+    }
+
+    depth = strcmp( kind, "string" ) ? 1 : 0;
+    width = depth ? sizeof( JudySlot ) : LATENCY_strlen;
+    keys = keys_make( kind, count, 1, width );
+
+    insert = calloc( 1, sizeof( OpLatency ) );
+    lookup = calloc( 1, sizeof( OpLatency ) );
+    delete = calloc( 1, sizeof( OpLatency ) );
+
+    if( !insert || !lookup || !delete || !( judy = judy_open( depth ? JUDY_key_size : LATENCY_strlen, depth ) ) ) {
+        fprintf( stderr, "out of memory\n" );
+        return 1;
+    }
+
+    //  the cost of reading the clock, which every time includes
+
+    for( idx = 0; idx < 1000; idx++ ) {
+        start = bench_now();
+        overhead += bench_now() - start;
+    }
+
+    printf( "judy_latency: %u %s keys, nanoseconds; clock %.1f\n", count, kind, overhead / 1000 );
+    printf( "%-14s %10s %8s %8s %8s %10s %10s\n", "operation", "count", "p50", "p99", "p99.9", "max", "of >p99.9" );
+
+    for( idx = 0; idx < count; idx++ ) {
+        key = keys + ( size_t )idx * width;
+        len = depth ? JUDY_key_size : strlen( ( char * )key );
+        before = judy->counters;
+        start = bench_now();
+        cell = judy_cell( judy, key, len );
+        latency_add( insert, bench_now() - start, event_of( &before, &judy->counters ) );
+        *cell = idx + 1;
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        key = keys + ( size_t )idx * width;
+        len = depth ? JUDY_key_size : strlen( ( char * )key );
+        start = bench_now();
+        judy_slot( judy, key, len );
+        latency_add( lookup, bench_now() - start, EVENT_none );
+    }
+
+    //  a delete is judy_slot to find the key, then judy_del
+
+    for( idx = 0; idx < count; idx++ ) {
+        key = keys + ( size_t )idx * width;
+        len = depth ? JUDY_key_size : strlen( ( char * )key );
+        before = judy->counters;
+        start = bench_now();
+        if( judy_slot( judy, key, len ) ) {
+            judy_del( judy );
+        }
+        latency_add( delete, bench_now() - start, event_of( &before, &judy->counters ) );
+    }
+
+    latency_print( "insert", insert );
+    latency_print( "lookup", lookup );
+    latency_print( "delete", delete );
+
+    judy_close( judy );
+    free( insert );
+    free( lookup );
+    free( delete );
+    free( keys );
+    return 0;
+}
@@ -0,0 +1,381 @@
+//  judy_memory: bytes per key, broken down by where they go, for
+//  several key distributions and array sizes - after filling the
+//  array, after deleting a random half of its keys, and after
+//  inserting as many new keys again, which shows how much of the
+//  memory freed into the reuse lists is used again.
+
+//  usage:
+//  judy_memory [maxkeys]
+//  arrays of 1000 keys and each tenfold larger size up to maxkeys
+//  (default 1000000; 100000000 needs several GB) are measured.
+
+//  Output is one JSON object per line: first the node configuration
+//  (JUDY_seg, JUDY_cache_line and the node sizes), then one line per
+//  distribution, size and phase, so that a change to JudySize[] or
+//  JUDY_cache_line can be judged on memory as well as on speed.
+
+//  The bytes malloc'ed for segments are split into:
+//      radix       radix nodes, outer and inner tables or flat
+//      index       radix index nodes, for up to JUDY_index_slots children
+//      linear      linear nodes, in total and by size class
+//      span        span nodes
+//      reuse       freed nodes waiting on the reuse lists
+//      data        judy_data allocations
+//      header      the judy object and its stack
+//      slack       the unused bottom of each segment, where an
+//                  allocation did not fit, and alignment
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "judy.h"
+#include "bench.h"
+
+#define MEMORY_record   24      // size of the values stored with judy_data
+#define MEMORY_chunk    4096    // records are carved from chunks this size
+#define MEMORY_strlen   64      // longest string key
+
+extern int JudySize[];
+
+typedef struct {
+    double radix, index, span, reuse, data, header, slack;
+    double linear[JUDY_max + 1];    // by size class
+    double total;                   // bytes malloc'ed for segments
+    unsigned int segments;
+} MemUsage;
+
+typedef struct {
+    const char * name;
+    int depth;                      // 1 for integer keys, 0 for strings
+    int records;                    // values are MEMORY_record bytes from judy_data
+} MemDistribution;
+
+static const MemDistribution Distributions[] = {
+    { "sequential", 1, 0 },
+    { "random", 1, 0 },
+    { "clustered", 1, 0 },
+    { "random-records", 1, 1 },
+    { "words", 0, 0 },
+    { "urls", 0, 0 }
+};
+
+static int bigEndian;
+static unsigned char * Chunk;      // records are carved from the top of Chunk
+static unsigned int ChunkLeft;
+
+//    bytes judy_alloc takes for a node of type
+
+static unsigned int node_bytes( int type ) {
+    unsigned int amt;
+
+    if( type == JUDY_radix ) {
+        type = JUDY_radix_equiv;
+    }
+    if( type == JUDY_span ) {
+        type = JUDY_span_equiv;
+    }
+
+    amt = JudySize[type];
+    return ( amt + 7 ) & ~7;
+}
+
+//    add up the nodes below next, which starts at byte off of the key
+
+static void walk( Judy * judy, MemUsage * m, JudySlot next, unsigned int off ) {
+    unsigned char * base = ( unsigned char * )( next & JUDY_mask );
+    int type = next & 0x07, keysize, cnt, slot, idx, leaf;
+    JudySlot * table, *inner, *node;
+
+    switch( type ) {
+        case JUDY_radix:
+            if( next & JUDY_index ) {
+                base -= JUDY_index;
+                node = ( JudySlot * )( base + 256 );
+                m->index += JUDY_index_size;
+
+                for( slot = 0; slot < 256; slot++ ) {
+                    if( judy->depth ) {
+                        leaf = !( ( off + 1 ) & JUDY_key_mask ) && ( off + 1 ) / JUDY_key_size == judy->depth;
+                    } else {
+                        leaf = !slot;
+                    }
+
+                    if( base[slot] && node[base[slot] - 1] && !leaf ) {
+                        walk( judy, m, node[base[slot] - 1], off + 1 );
+                    }
+                }
+                return;
+            }
+
+            if( next & JUDY_flat ) {
+                table = ( JudySlot * )( base - JUDY_flat );
+                m->radix += JUDY_flat_size;
+
+                for( slot = 0; slot < 256; slot++ ) {
+                    if( judy->depth ) {
+                        leaf = !( ( off + 1 ) & JUDY_key_mask ) && ( off + 1 ) / JUDY_key_size == judy->depth;
+                    } else {
+                        leaf = !slot;
+                    }
+
+                    if( table[slot] && !leaf ) {
+                        walk( judy, m, table[slot], off + 1 );
+                    }
+                }
+                return;
+            }
+
+            table = ( JudySlot * )base;
+            m->radix += node_bytes( JUDY_radix );
+
+            for( idx = 0; idx < 16; idx++ ) {
+                if( !( inner = ( JudySlot * )( table[idx] & JUDY_mask ) ) ) {
+                    continue;
+                }
+
+                m->radix += node_bytes( JUDY_radix );
+
+                for( slot = 0; slot < 16; slot++ ) {
+                    if( judy->depth ) {
+                        leaf = !( ( off + 1 ) & JUDY_key_mask ) && ( off + 1 ) / JUDY_key_size == judy->depth;
+                    } else {
+                        leaf = !idx && !slot;
+                    }
+
+                    if( inner[slot] && !leaf ) {
+                        walk( judy, m, inner[slot], off + 1 );
+                    }
+                }
+            }
+            return;
+
+        case JUDY_span:
+            node = ( JudySlot * )( base + JudySize[JUDY_span] );
+            m->span += node_bytes( JUDY_span );
+
+            if( node[-1] && !memchr( base, 0, JUDY_span_bytes ) ) {
+                walk( judy, m, node[-1], off + JUDY_span_bytes );
+            }
+            return;
+
+        default:
+            keysize = JUDY_key_size - ( off & JUDY_key_mask );
+            cnt = JudySize[type] / ( sizeof( JudySlot ) + keysize );
+            node = ( JudySlot * )( base + JudySize[type] );
+            m->linear[type] += node_bytes( type );
+
+            for( slot = 0; slot < cnt; slot++ ) {
+                if( judy->depth ) {
+                    leaf = ( off | JUDY_key_mask ) + 1 == judy->depth * JUDY_key_size;
+                } else {
+                    leaf = !base[slot * keysize + ( bigEndian ? keysize - 1 : 0 )];
+                }
+
+                if( node[-slot - 1] && !leaf ) {
+                    walk( judy, m, node[-slot - 1], ( off | JUDY_key_mask ) + 1 );
+                }
+            }
+            return;
+    }
+}
+
+static void usage_get( Judy * judy, MemUsage * m ) {
+    double nodes = 0;
+    JudySeg * seg;
+    void ** block;
+    int type;
+
+    memset( m, 0, sizeof( *m ) );
+
+    if( *judy->root ) {
+        walk( judy, m, *judy->root, 0 );
+    }
+
+    for( type = 0; type < 8; type++ )
+        for( block = judy->reuse[type]; block; block = *block ) {
+            m->reuse += type == JUDY_radix ? JUDY_flat_size : ( JudySize[type] + 7 ) & ~7;
+        }
+
+    for( block = judy->reuse[JUDY_index_reuse]; block; block = *block ) {
+        m->reuse += JUDY_index_size;
+    }
+
+    //    segments are filled from the top down, below a top
+    //    rounded down to the cache line; seg->next is the
+    //    bottom of what has been taken
+
+    for( seg = judy->seg; seg; seg = seg->seg ) {
+        m->segments++;
+        m->total += JUDY_seg;
+        m->slack += seg->next + ( ( JudySlot )seg & ( JUDY_cache_line - 1 ) );
+    }
+
+    m->header = sizeof( Judy ) + judy->max * sizeof( JudyStack );
+    m->header = ( ( unsigned int )m->header + JUDY_cache_line - 1 ) & ~( JUDY_cache_line - 1 );
+
+    for( type = JUDY_1; type <= JUDY_max; type++ ) {
+        nodes += m->linear[type];
+    }
+
+    m->data = m->total - m->slack - m->header - m->radix - m->index - m->span - nodes - m->reuse;
+}
+
+static void usage_print( const char * distribution, unsigned int size, const char * phase, unsigned int live, Judy * judy ) {
+    double linear = 0;
+    MemUsage m;
+    int type;
+
+    usage_get( judy, &m );
+
+    for( type = JUDY_1; type <= JUDY_max; type++ ) {
+        linear += m.linear[type];
+    }
+
+    printf( "{ \"distribution\": \"%s\", \"size\": %u, \"phase\": \"%s\", \"keys\": %u, \"segments\": %u, ",
+            distribution, size, phase, live, m.segments );
+    printf( "\"bytes\": %.0f, \"bytes_per_key\": %.2f, \"radix\": %.0f, \"index\": %.0f, \"linear\": %.0f, \"span\": %.0f, ",
+            m.total, m.total / live, m.radix, m.index, linear, m.span );
+    printf( "\"reuse\": %.0f, \"data\": %.0f, \"header\": %.0f, \"slack\": %.0f, \"linear_by_class\": [",
+            m.reuse, m.data, m.header, m.slack );
+
+    for( type = JUDY_1; type <= JUDY_max; type++ ) {
+        printf( "%s%.0f", type == JUDY_1 ? "" : ", ", m.linear[type] );
+    }
+
+    printf( "] }\n" );
+    fflush( stdout );
+}
+
+//    key idx of a distribution, into buff; returns its length
+
+static unsigned int key_make( const MemDistribution * d, unsigned int idx, uint64_t salt, unsigned char * buff ) {
+    uint64_t seed = idx ^ salt << 32, value;
+    unsigned int len, i;
+
+    if( !d->depth ) {
+        i = 0;
+        if( !strcmp( d->name, "urls" ) ) {
+            i = sprintf( ( char * )buff, "https://www.host%u.example.com/", ( unsigned int )( bench_rand( &seed ) % 500 ) );
+        }
+        len = i + 4 + bench_rand( &seed ) % 12;
+        while( i < len ) {
+            buff[i++] = 'a' + bench_rand( &seed ) % 26;
+        }
+        buff[len] = 0;
+        return len;
+    }
+
+    if( !strcmp( d->name, "sequential" ) ) {
+        value = ( uint64_t )idx + salt * 0x100000000ULL;
+    } else if( !strcmp( d->name, "clustered" ) ) {
+        seed = idx / 256 ^ salt << 32;      // runs of 256 keys within 64K of a random base
+        value = bench_rand( &seed ) & ~( uint64_t )0xffff;
+        seed = idx ^ salt << 32;
+        value += bench_rand( &seed ) & 0xffff;
+    } else {
+        value = bench_rand( &seed );
+    }
+
+    memcpy( buff, &value, sizeof( JudySlot ) );
+    return JUDY_key_size;
+}
+
+//    insert keys first to first + count - 1; returns how many were new
+
+static unsigned int fill( Judy * judy, const MemDistribution * d, unsigned int first, unsigned int count, uint64_t salt ) {
+    unsigned char buff[MEMORY_strlen + 1];
+    unsigned int idx, len, added = 0;
+    JudySlot * cell;
+
+    for( idx = first; idx < first + count; idx++ ) {
+        len = key_make( d, idx, salt, buff );
+        if( !( cell = judy_cell( judy, buff, len ) ) ) {
+            fprintf( stderr, "judy_cell: out of memory\n" );
+            exit( 1 );
+        }
+
+        if( *cell ) {
+            continue;
+        }
+
+        added++;
+
+        if( !d->records ) {
+            *cell = idx + 1;
+            continue;
+        }
+
+        if( ChunkLeft < MEMORY_record ) {
+            Chunk = judy_data( judy, MEMORY_chunk );
+            ChunkLeft = MEMORY_chunk;
+        }
+        *cell = ( JudySlot )( Chunk + MEMORY_chunk - ChunkLeft );
+        ChunkLeft -= MEMORY_record;
+    }
+
+    return added;
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int maxkeys = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    unsigned char buff[MEMORY_strlen + 1];
+    unsigned int size, live, deleted, idx, len, type;
+    const MemDistribution * d;
+    JudySlot * cell;
+    uint64_t seed;
+    union {
+        unsigned short word;
+        unsigned char byte;
+    } order;
+    Judy * judy;
+
+    if( maxkeys < 1000 ) {
+        fprintf( stderr, "usage: %s [maxkeys], maxkeys at least 1000\n", argv[0] );
+        return 1;
+    }
+
+    order.word = 1;
+    bigEndian = !order.byte;
+
+    printf( "{ \"config\": { \"JUDY_seg\": %u, \"JUDY_cache_line\": %u, \"JUDY_key_size\": %u, \"JudySize\": [",
+            JUDY_seg, JUDY_cache_line, JUDY_key_size );
+    for( type = 0; type < 8; type++ ) {
+        printf( "%s%d", type ? ", " : "", JudySize[type] );
+    }
+    printf( "] } }\n" );
+
+    for( d = Distributions; d < Distributions + sizeof( Distributions ) / sizeof( *Distributions ); d++ )
+        for( size = 1000; size && size <= maxkeys; size = size <= 0xffffffffU / 10 ? size * 10 : 0 ) {
+            judy = judy_open( d->depth ? JUDY_key_size : MEMORY_strlen, d->depth );
+            ChunkLeft = 0;
+
+            live = fill( judy, d, 0, size, 0 );
+            usage_print( d->name, size, "insert", live, judy );
+
+            //  delete a random half of the keys
+
+            for( deleted = idx = 0, seed = size; idx < size; idx++ ) {
+                if( bench_rand( &seed ) & 1 ) {
+                    continue;
+                }
+                len = key_make( d, idx, 0, buff );
+                if( ( cell = judy_slot( judy, buff, len ) ) && *cell ) {
+                    judy_del( judy );
+                    deleted++;
+                }
+            }
+
+            live -= deleted;
+            usage_print( d->name, size, "delete-half", live, judy );
+
+            //  and insert as many new keys
+
+            live += fill( judy, d, 0, deleted, 1 );
+            usage_print( d->name, size, "refill", live, judy );
+
+            judy_close( judy );
+        }
+
+    return 0;
+}
@@ -0,0 +1,298 @@
+//  judy_overhead: what the template layer costs over the C API. Each
+//  method of judyLArray and judySArray is timed against the judy.c
+//  calls it is made of, on the same keys, and the ratio reported, so
+//  that changes to the wrappers can be measured.
+
+//  usage:
+//  judy_overhead [count] [rounds]
+//  count defaults to 1000000 keys, random 64-bit integers and random
+//  strings of 4 to 23 characters; each pair is timed rounds times,
+//  default 5, and the fastest time kept.
+
+//  The C side does only what a caller of judy.c would have to:
+//      insert        judy_cell, and store the value
+//      find          judy_get, and load the value
+//      atOrAfter     judy_strt, and load the value; the template also
+//                    builds the key with judy_key
+//      begin/next    judy_strt from the empty key, then judy_nxt; the
+//                    template builds each key with judy_key
+//      first/nextValue   the same, for the methods that build no key
+//  String keys are passed to the templates NUL-terminated, so that
+//  judyStringKey finds their length with strlen, and again with
+//  their length; the C side is given the length.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "judyLArray.h"
+#include "judySArray.h"
+#include "bench.h"
+
+#define OVERHEAD_strlen 24      // string keys are up to 23 bytes
+
+enum { opInsert, opInsertLen, opFind, opFindLen, opAtOrAfter, opScan, opScanValues, opCount };
+
+static const char * OpNames[opCount] = {
+    "insert", "insert(len)", "find", "find(len)", "atOrAfter", "begin/next", "first/nextValue"
+};
+
+/// fastest time per operation, in ns, of the template and of the C API
+struct timing {
+    double tmpl[opCount], raw[opCount];
+    bool used[opCount];
+};
+
+/// keep the fastest of the rounds
+static void keep( double * best, double ns, size_t ops ) {
+    double per = ns / ( ops ? ops : 1 );
+    if( *best <= 0 || per < *best ) {
+        *best = per;
+    }
+}
+
+/// a lookup that found the wrong value, or a scan that summed differently
+static void mismatch( const char * what, uint64_t tmpl, uint64_t raw ) {
+    if( tmpl != raw ) {
+        fprintf( stderr, "judy_overhead: %s differs, template %llu, judy.c %llu\n", what, ( unsigned long long ) tmpl, ( unsigned long long ) raw );
+        exit( EXIT_FAILURE );
+    }
+}
+
+/// one round of every operation on integer keys
+static void roundL( const std::vector< uint64_t > & keys, timing & t ) {
+    typedef judyLArray< uint64_t, uint64_t > array;
+    array * m = new array;
+    Judy * judy = judy_open( JUDY_key_size, 1 );
+    uint64_t sumT = 0, sumR = 0, v, zero = 0;
+    JudySlot * cell;
+    size_t idx, steps;
+    double start;
+
+    start = bench_now();
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        m->insert( keys[idx], idx + 1 );
+    }
+    keep( &t.tmpl[opInsert], bench_now() - start, keys.size() );
+
+    start = bench_now();
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        *judy_cell( judy, ( const unsigned char * ) &keys[idx], JUDY_key_size ) = idx + 1;
+    }
+    keep( &t.raw[opInsert], bench_now() - start, keys.size() );
+
+    start = bench_now();
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        sumT += m->find( keys[idx] );
+    }
+    keep( &t.tmpl[opFind], bench_now() - start, keys.size() );
+
+    start = bench_now();
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        if( ( cell = judy_get( judy, ( const unsigned char * ) &keys[idx], JUDY_key_size ) ) ) {
+            sumR += *cell;
+        }
+    }
+    keep( &t.raw[opFind], bench_now() - start, keys.size() );
+    mismatch( "find", sumT, sumR );
+
+    sumT = sumR = 0;
+    start = bench_now();
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        sumT += m->atOrAfter( keys[idx] ).value;
+    }
+    keep( &t.tmpl[opAtOrAfter], bench_now() - start, keys.size() );
+
+    start = bench_now();
+    for( idx = 0; idx < keys.size(); idx++ ) {
+        if( ( cell = judy_strt( judy, ( const unsigned char * ) &keys[idx], JUDY_key_size ) ) ) {
+            sumR += *cell;
+        }
+    }
+    keep( &t.raw[opAtOrAfter], bench_now() - start, keys.size() );
+    mismatch( "atOrAfter", sumT, sumR );
+
+    sumT = sumR = 0;
+    steps = 0;
+    start = bench_now();
+    for( v = m->begin().value; m->success(); v = m->next().value ) {
+        sumT += v;
+        steps++;
+    }
+    keep( &t.tmpl[opScan], bench_now() - start, steps );
+
+    start = bench_now();
+    for( cell = judy_strt( judy, ( const unsigned char * ) &zero, 0 ); cell; cell = judy_nxt( judy ) ) {
+        sumR += *cell;
+    }
+    keep( &t.raw[opScan], bench_now() - start, steps );
+    mismatch( "begin/next", sumT, sumR );
+
+    sumT = 0;
+    start = bench_now();
+    for( uint64_t * p = m->firstValue(); p; p = m->nextValue() ) {
+        sumT += *p;
+    }
+    keep( &t.tmpl[opScanValues], bench_now() - start, steps );
+    t.raw[opScanValues] = t.raw[opScan];
+    mismatch( "firstValue/nextValue", sumT, sumR );
+
+    t.used[opInsert] = t.used[opFind] = t.used[opAtOrAfter] = t.used[opScan] = t.used[opScanValues] = true;
+    delete m;
+    judy_close( judy );
+}
+
+/// one round of every operation on string keys
+static void roundS( const std::vector< char > & keys, const std::vector< unsigned int > & lens, timing & t ) {
+    typedef judySArray< uint64_t > array;
+    array * m = new array( OVERHEAD_strlen );
+    array * n = new array( OVERHEAD_strlen );
+    Judy * judy = judy_open( OVERHEAD_strlen, 0 );
+    uint64_t sumT = 0, sumR = 0, v;
+    unsigned char empty[1] = { 0 };
+    size_t idx, count = lens.size(), steps;
+    JudySlot * cell;
+    double start;
+
+#define OVERHEAD_key( idx ) ( &keys[( idx ) * OVERHEAD_strlen] )
+
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        m->insert( OVERHEAD_key( idx ), idx + 1 );
+    }
+    keep( &t.tmpl[opInsert], bench_now() - start, count );
+
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        n->insert( OVERHEAD_key( idx ), idx + 1, lens[idx] );
+    }
+    keep( &t.tmpl[opInsertLen], bench_now() - start, count );
+
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        *judy_cell( judy, ( const unsigned char * ) OVERHEAD_key( idx ), lens[idx] ) = idx + 1;
+    }
+    keep( &t.raw[opInsert], bench_now() - start, count );
+    t.raw[opInsertLen] = t.raw[opInsert];
+
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        sumT += m->find( OVERHEAD_key( idx ) );
+    }
+    keep( &t.tmpl[opFind], bench_now() - start, count );
+
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        sumR += m->find( OVERHEAD_key( idx ), lens[idx] );
+    }
+    keep( &t.tmpl[opFindLen], bench_now() - start, count );
+    mismatch( "find(len)", sumT, sumR );
+
+    sumR = 0;
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        if( ( cell = judy_get( judy, ( const unsigned char * ) OVERHEAD_key( idx ), lens[idx] ) ) ) {
+            sumR += *cell;
+        }
+    }
+    keep( &t.raw[opFind], bench_now() - start, count );
+    t.raw[opFindLen] = t.raw[opFind];
+    mismatch( "find", sumT, sumR );
+
+    sumT = sumR = 0;
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        sumT += m->atOrAfter( OVERHEAD_key( idx ), lens[idx] ).value;
+    }
+    keep( &t.tmpl[opAtOrAfter], bench_now() - start, count );
+
+    start = bench_now();
+    for( idx = 0; idx < count; idx++ ) {
+        if( ( cell = judy_strt( judy, ( const unsigned char * ) OVERHEAD_key( idx ), lens[idx] ) ) ) {
+            sumR += *cell;
+        }
+    }
+    keep( &t.raw[opAtOrAfter], bench_now() - start, count );
+    mismatch( "atOrAfter", sumT, sumR );
+
+#undef OVERHEAD_key
+
+    sumT = sumR = 0;
+    steps = 0;
+    start = bench_now();
+    for( v = m->begin().value; m->success(); v = m->next().value ) {
+        sumT += v;
+        steps++;
+    }
+    keep( &t.tmpl[opScan], bench_now() - start, steps );
+
+    start = bench_now();
+    for( cell = judy_strt( judy, empty, 0 ); cell; cell = judy_nxt( judy ) ) {
+        sumR += *cell;
+    }
+    keep( &t.raw[opScan], bench_now() - start, steps );
+    mismatch( "begin/next", sumT, sumR );
+
+    sumT = 0;
+    start = bench_now();
+    for( uint64_t * p = m->firstValue(); p; p = m->nextValue() ) {
+        sumT += *p;
+    }
+    keep( &t.tmpl[opScanValues], bench_now() - start, steps );
+    t.raw[opScanValues] = t.raw[opScan];
+    mismatch( "firstValue/nextValue", sumT, sumR );
+
+    for( int op = 0; op < opCount; op++ ) {
+        t.used[op] = true;
+    }
+    delete m;
+    delete n;
+    judy_close( judy );
+}
+
+static void report( const char * array, const timing & t ) {
+    for( int op = 0; op < opCount; op++ ) {
+        if( t.used[op] ) {
+            printf( "%-12s %-16s %10.1f %10.1f %8.2f\n", array, OpNames[op], t.tmpl[op], t.raw[op], t.tmpl[op] / t.raw[op] );
+        }
+    }
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    unsigned int rounds = argc > 2 ? strtoul( argv[2], NULL, 10 ) : 5;
+    std::vector< uint64_t > ints( count );
+    std::vector< char > strs( ( size_t ) count * OVERHEAD_strlen );
+    std::vector< unsigned int > lens( count );
+    uint64_t seed = 1;
+    unsigned int idx, i, round;
+    timing l, s;
+
+    if( !count || !rounds ) {
+        fprintf( stderr, "usage: %s [count] [rounds]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        ints[idx] = bench_rand( &seed );
+        lens[idx] = 4 + bench_rand( &seed ) % ( OVERHEAD_strlen - 5 );
+        for( i = 0; i < lens[idx]; i++ ) {
+            strs[( size_t ) idx * OVERHEAD_strlen + i] = 'a' + bench_rand( &seed ) % 26;
+        }
+        strs[( size_t ) idx * OVERHEAD_strlen + lens[idx]] = 0;
+    }
+
+    memset( &l, 0, sizeof( l ) );
+    memset( &s, 0, sizeof( s ) );
+
+    for( round = 0; round < rounds; round++ ) {
+        roundL( ints, l );
+        roundS( strs, lens, s );
+    }
+
+    printf( "judy_overhead: %u keys, fastest of %u rounds, ns/op\n", count, rounds );
+    printf( "%-12s %-16s %10s %10s %8s\n", "array", "operation", "template", "judy.c", "ratio" );
+    report( "judyLArray", l );
+    report( "judySArray", s );
+    return EXIT_SUCCESS;
+}
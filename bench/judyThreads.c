@@ -0,0 +1,204 @@
+//  judy_threads: how read-only lookups and scans scale over threads
+//  sharing one judy array, each with a judy_clone of its own.
+
+//  usage:
+//  judy_threads [count] [maxthreads]
+//  count defaults to 1000000 random 64-bit keys, maxthreads to the
+//  number of online processors; 1, 2, 4 ... maxthreads are measured.
+
+//  Each thread does count lookups with judy_slot of keys drawn from
+//  those inserted, then count steps of judy_nxt in runs of 64 from
+//  judy_strt at such a key.  Aggregate throughput is reported, and
+//  its speedup over one thread.
+
+//  Clones are allocated with judy_data from the parent's segments,
+//  next to each other, and every lookup writes the clone's stack.
+//  Two threads writing to the same cache line - or to the same pair
+//  of lines, which many processors prefetch together - would slow
+//  each other down.  So the clones' addresses are checked for lines
+//  and line pairs they share, and every run is made twice: with the
+//  clones packed as judy_clone leaves them, and padded apart by a
+//  judy_data gap.  Packed throughput well below padded means false
+//  sharing.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "judy.h"
+#include "bench.h"
+
+#define THREADS_max   256
+#define THREADS_run   64                      // judy_nxt steps per judy_strt
+#define THREADS_pair  ( 2 * JUDY_cache_line )  // lines prefetched together
+
+typedef struct {
+    Judy * clone;
+    const JudySlot * keys;
+    unsigned int count;
+    uint64_t seed;
+    double lookupNs, scanNs;        // time taken by each phase
+    unsigned int found;
+} Reader;
+
+static pthread_mutex_t Gate = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Open = PTHREAD_COND_INITIALIZER;
+static int Started;
+
+static void * reader_run( void * arg ) {
+    Reader * r = arg;
+    unsigned int idx, step, found = 0;
+    uint64_t seed = r->seed;        // kept off the readers' shared array
+    JudySlot key, *cell;
+    double start;
+
+    //  wait until all the threads have been created
+
+    pthread_mutex_lock( &Gate );
+    while( !Started ) {
+        pthread_cond_wait( &Open, &Gate );
+    }
+    pthread_mutex_unlock( &Gate );
+
+    start = bench_now();
+    for( idx = 0; idx < r->count; idx++ ) {
+        key = r->keys[bench_rand( &seed ) % r->count];
+        if( judy_slot( r->clone, ( unsigned char * )&key, JUDY_key_size ) ) {
+            found++;
+        }
+    }
+    r->lookupNs = bench_now() - start;
+
+    start = bench_now();
+    for( idx = 0; idx < r->count; ) {
+        key = r->keys[bench_rand( &seed ) % r->count];
+        cell = judy_strt( r->clone, ( unsigned char * )&key, JUDY_key_size );
+        for( step = 0; cell && step < THREADS_run && idx < r->count; step++, idx++ ) {
+            cell = judy_nxt( r->clone );
+        }
+        if( !cell ) {
+            idx++;  // ran off the end
+        }
+    }
+    r->scanNs = bench_now() - start;
+    r->found = found;
+    return NULL;
+}
+
+//    count the clones that share a block of size bytes with another
+
+static unsigned int shared_blocks( Reader * readers, unsigned int threads, unsigned int amt, unsigned int size ) {
+    unsigned int idx, other, shared = 0;
+    JudySlot first, last, start, end;
+
+    for( idx = 0; idx < threads; idx++ ) {
+        first = ( JudySlot )readers[idx].clone & ~( JudySlot )( size - 1 );
+        last = ( ( JudySlot )readers[idx].clone + amt - 1 ) & ~( JudySlot )( size - 1 );
+
+        for( other = 0; other < threads; other++ ) {
+            start = ( JudySlot )readers[other].clone & ~( JudySlot )( size - 1 );
+            end = ( ( JudySlot )readers[other].clone + amt - 1 ) & ~( JudySlot )( size - 1 );
+
+            if( other != idx && start <= last && end >= first ) {
+                shared++;
+                break;
+            }
+        }
+    }
+
+    return shared;
+}
+
+//    run threads readers over judy, with clones packed or padded apart
+
+static void threads_run( Judy * judy, const JudySlot * keys, unsigned int count, unsigned int threads, int padded, double * base ) {
+    unsigned int amt = sizeof( Judy ) + judy->max * sizeof( JudyStack ), idx, found = 0;
+    pthread_t ids[THREADS_max];
+    Reader readers[THREADS_max];
+    double lookups = 0, scans = 0;
+
+    for( idx = 0; idx < threads; idx++ ) {
+        if( padded && idx ) {
+            judy_data( judy, THREADS_pair );
+        }
+        memset( readers + idx, 0, sizeof( Reader ) );
+        readers[idx].clone = judy_clone( judy );
+        readers[idx].keys = keys;
+        readers[idx].count = count;
+        readers[idx].seed = idx + 1;
+    }
+
+    Started = 0;
+    for( idx = 0; idx < threads; idx++ )
+        if( pthread_create( ids + idx, NULL, reader_run, readers + idx ) ) {
+            fprintf( stderr, "pthread_create failed\n" );
+            exit( 1 );
+        }
+
+    pthread_mutex_lock( &Gate );
+    Started = 1;
+    pthread_cond_broadcast( &Open );
+    pthread_mutex_unlock( &Gate );
+
+    for( idx = 0; idx < threads; idx++ ) {
+        pthread_join( ids[idx], NULL );
+        lookups += count * 1e3 / readers[idx].lookupNs;
+        scans += count * 1e3 / readers[idx].scanNs;
+        found += readers[idx].found;
+    }
+
+    if( found != count * threads ) {
+        fprintf( stderr, "%u of %u lookups found their key\n", found, count * threads );
+        exit( 1 );
+    }
+
+    if( !padded && threads == 1 ) {
+        base[0] = lookups, base[1] = scans;
+    }
+
+    printf( "%7u %-7s %12.2f %8.2f %12.2f %8.2f %8u %8u\n", threads, padded ? "padded" : "packed",
+            lookups, lookups / base[0], scans, scans / base[1],
+            shared_blocks( readers, threads, amt, JUDY_cache_line ), shared_blocks( readers, threads, amt, THREADS_pair ) );
+}
+
+int main( int argc, char ** argv ) {
+    unsigned int count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 1000000;
+    long online = sysconf( _SC_NPROCESSORS_ONLN );
+    unsigned int maxthreads = argc > 2 ? strtoul( argv[2], NULL, 10 ) : online > 0 ? online : 1;
+    unsigned int idx, threads;
+    double base[2];
+    JudySlot * keys;
+    uint64_t seed = 1;
+    Judy * judy;
+
+    if( !count || !maxthreads || maxthreads > THREADS_max ) {
+        fprintf( stderr, "usage: %s [count] [maxthreads], maxthreads at most %d\n", argv[0], THREADS_max );
+        return 1;
+    }
+
+    if( !( keys = malloc( count * sizeof( JudySlot ) ) ) || !( judy = judy_open( JUDY_key_size, 1 ) ) ) {
+        fprintf( stderr, "out of memory for %u keys\n", count );
+        return 1;
+    }
+
+    for( idx = 0; idx < count; idx++ ) {
+        keys[idx] = ( JudySlot )bench_rand( &seed );
+        *judy_cell( judy, ( unsigned char * )( keys + idx ), JUDY_key_size ) = idx + 1;
+    }
+
+    printf( "judy_threads: %u random keys, %ld processors online; clones of %u bytes\n",
+            count, online, ( unsigned int )( sizeof( Judy ) + judy->max * sizeof( JudyStack ) ) );
+    printf( "%7s %-7s %12s %8s %12s %8s %8s %8s\n", "threads", "clones", "lookup Mop/s", "speedup",
+            "scan Mop/s", "speedup", "shr-line", "shr-pair" );
+
+    for( threads = 1; threads <= maxthreads; threads = threads < maxthreads && threads * 2 > maxthreads ? maxthreads : threads * 2 ) {
+        threads_run( judy, keys, count, threads, 0, base );
+        threads_run( judy, keys, count, threads, 1, base );
+    }
+
+    judy_close( judy );
+    free( keys );
+    return 0;
+}
@@ -16,6 +16,11 @@
 
 //  STANDALONE is defined to compile into a string sorter.
 
+//  JUDY_INSTRUMENT is defined to keep structural event counters
+//  in each judy object (see JudyCounters in judy.h).  judy_get
+//  then writes to the array it reads, so concurrent readers
+//  should each use a clone of it.
+
 //  String mappings are denoted by calling judy_open with zero as
 //  the second argument.  Integer mappings are denoted by calling
 //  judy_open with the Integer depth of the Judy Trie as the second
@@ -27,15 +32,23 @@
 //  judy_open:  open a new judy array returning a judy object.
 //  judy_close: close an open judy array, freeing all memory.
 //  judy_clone: clone an open judy array, duplicating the stack.
+//  judy_cursor: open a private, read-only cursor on a judy array.
+//  judy_cursor_close: close a cursor from judy_cursor.
 //  judy_data:  allocate data memory within judy array for external use.
 //  judy_cell:  insert a string into the judy array, return cell pointer.
+//  judy_append: judy_cell, resuming from the current stack; for sorted keys.
 //  judy_strt:  retrieve the cell pointer greater than or equal to given key
+//  judy_seek:  judy_strt, resuming from the current stack (finger search).
 //  judy_slot:  retrieve the cell pointer, or return NULL for a given key.
+//  judy_get:   judy_slot without moving the stack; safe for concurrent readers.
 //  judy_key:   retrieve the string value for the most recent judy query.
 //  judy_end:   retrieve the cell pointer for the last string in the array.
 //  judy_nxt:   retrieve the cell pointer for the next string in the array.
 //  judy_prv:   retrieve the cell pointer for the prev string in the array.
-//  judy_del:   delete the key and cell for the current stack entry.
+//  judy_nxt_key: judy_nxt, updating the key in the caller's buffer.
+//  judy_prv_key: judy_prv, updating the key in the caller's buffer.
+//  judy_del:   delete the key and cell for the current stack entry,
+//              shrinking nodes that become sparse.
 
 #include <memory.h>
 #include <stdlib.h>
@@ -90,6 +103,36 @@ int JudySize[] = {
 #endif
 };
 
+//    count structural events in the judy object
+//    when compiled with -DJUDY_INSTRUMENT, and
+//    compile to nothing otherwise.
+
+#ifdef JUDY_INSTRUMENT
+#  define JUDY_count( judy, counter ) ( ( judy )->counters.counter++ )
+#  define JUDY_descent( judy, levels ) ( ( judy )->counters.depths[( levels ) < JUDY_depths ? ( levels ) : JUDY_depths]++ )
+#  define JUDY_lookup( judy, levels, cell ) judy_lookup( ( Judy * )( judy ), levels, cell )
+#  define JUDY_inserted( judy, cell ) ( ( cell ) && *( cell ) ? ( judy )->counters.found++ : ( judy )->counters.inserts++, JUDY_descent( judy, ( judy )->level ) )
+#else
+#  define JUDY_count( judy, counter )
+#  define JUDY_descent( judy, levels )
+#  define JUDY_lookup( judy, levels, cell ) ( cell )
+#  define JUDY_inserted( judy, cell )
+#endif
+
+#ifdef JUDY_INSTRUMENT
+//    count a lookup that went levels nodes deep,
+//    and pass on the cell it found.
+
+static JudySlot * judy_lookup( Judy * judy, unsigned int levels, JudySlot * cell ) {
+    judy->counters.lookups++;
+    if( cell ) {
+        judy->counters.hits++;
+    }
+    JUDY_descent( judy, levels );
+    return cell;
+}
+#endif
+
 judyvalue JudyMask[9] = {
     0, 0xff, 0xffff, 0xffffff, 0xffffffff,
 #if JUDY_key_size > 4
@@ -97,6 +140,96 @@ judyvalue JudyMask[9] = {
 #endif
 };
 
+//    runtime CPU dispatch: with GCC on x86-64 linux, functions
+//    marked JUDY_clones are compiled for AVX-512, for AVX2 and
+//    for the baseline, and the dynamic loader picks the best
+//    one the CPU has when the program starts.  so a portable
+//    build still gets the vector units where they exist.
+//    -DJUDY_NO_DISPATCH compiles the baseline alone.
+
+#if !defined(JUDY_NO_DISPATCH) && defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6 && defined(__x86_64__) && defined(__linux__)
+#  define JUDY_clones __attribute__(( target_clones( "avx512f", "avx2", "default" ) ))
+#else
+#  define JUDY_clones
+#endif
+
+//    smallest linear node searched with judy_countle
+
+#ifndef JUDY_countle_min
+#  define JUDY_countle_min 8
+#endif
+
+//    count the keys not greater than value, in a linear node
+//    of whole-word keys.  there is no early exit, so that the
+//    loop compiles to vector compares.
+
+JUDY_clones
+static int judy_countle( const judyvalue * keys, int cnt, judyvalue value ) {
+    int idx, le = 0;
+
+    for( idx = 0; idx < cnt; idx++ ) {
+        le += keys[idx] <= value;
+    }
+
+    return le;
+}
+
+#ifdef JUDY_INSTRUMENT
+//    cache lines of a linear node read by judy_search: the keys
+//    from slot up, or all of them if counted with judy_countle,
+//    and the cell of the slot when the key was found.
+
+static unsigned int judy_lines( const unsigned char * base, int size, int cnt, int keysize, int slot, int found ) {
+    JudySlot first = ( JudySlot )base, last = ( JudySlot )base + cnt * keysize - 1;
+    JudySlot cell = ( JudySlot )base + size - ( slot + 1 ) * sizeof( JudySlot );
+    unsigned int lines;
+
+    if( slot > 0 && ( keysize < JUDY_key_size || cnt < JUDY_countle_min ) ) {
+        first += slot * keysize;
+    }
+
+    lines = last / JUDY_cache_line - first / JUDY_cache_line + 1;
+
+    if( found && cell / JUDY_cache_line > last / JUDY_cache_line ) {
+        lines++;
+    }
+
+    return lines;
+}
+
+#  define JUDY_lines( judy, base, size, cnt, keysize, slot, found ) ( ( ( Judy * )( judy ) )->counters.lines += judy_lines( base, size, cnt, keysize, slot, found ) )
+#else
+#  define JUDY_lines( judy, base, size, cnt, keysize, slot, found )
+#endif
+
+//    find the last slot of a linear node whose key is not greater
+//    than value, or -1, and return the key tested last in test.
+//    keys are kept in ascending order, empty slots at the bottom.
+
+static int judy_search( const unsigned char * base, int cnt, int keysize, judyvalue value, judyvalue * test ) {
+    int slot = cnt;
+
+    if( keysize == JUDY_key_size && cnt >= JUDY_countle_min ) {
+        slot = judy_countle( ( const judyvalue * )base, cnt, value ) - 1;
+        *test = slot < 0 ? ~value : ( ( const judyvalue * )base )[slot];
+        return slot;
+    }
+
+    while( slot-- ) {
+        *test = *( const judyvalue * )( base + slot * keysize );
+#if BYTE_ORDER == BIG_ENDIAN
+        *test >>= 8 * ( JUDY_key_size - keysize );
+#else
+        *test &= JudyMask[keysize];
+#endif
+        if( *test <= value ) {
+            break;
+        }
+    }
+
+    return slot;
+}
+
 //    open judy object
 //        call with max key size
 //        and Integer tree depth.
@@ -137,17 +270,89 @@ Judy * judy_open( unsigned int max, unsigned int depth ) {
     judy->depth = depth;
     judy->seg = seg;
     judy->max = max;
+    JUDY_count( judy, segments );
     return judy;
 }
 
 void judy_close( Judy * judy ) {
-    JudySeg * seg, *nxt = judy->seg;
+    JudySeg * seg, *nxt;
+
+    if( !judy ) {
+        return;
+    }
+
+    nxt = judy->seg;
 
     while( ( seg = nxt ) ) {
         nxt = seg->seg, free( seg );
     }
 }
 
+//    node sizes are powers of two, and judy_alloc carves them
+//    from cache-line multiples at the cache-line aligned top of
+//    a segment, so every node is aligned to its own size or to
+//    JUDY_cache_line, whichever is smaller: a node never shares
+//    a cache line with another unless both are smaller than one,
+//    and a linear node's keys start on a line boundary.
+
+typedef char JudyNodeSizeCheck[( ( JUDY_slot_size + JUDY_key_size ) & ( JUDY_slot_size + JUDY_key_size - 1 ) ) ? -1 : 1];
+
+//    radix tables are then aligned to at least 16 bytes, so
+//    JUDY_flat is free in radix node pointers.  a radix node is
+//    made flat when JUDY_flat_tables of its 16 inner tables are
+//    in use: a lookup then reads its slot without first reading
+//    the outer table, and from 15 inner tables on, the flat node
+//    is smaller as well.  17 never makes radix nodes flat.
+
+typedef char JudyFlatCheck[JUDY_cache_line < 16 ? -1 : 1];
+
+#ifndef JUDY_flat_tables
+#  define JUDY_flat_tables 12
+#endif
+
+//    index nodes come from judy_data, and need JUDY_index free
+//    in their pointers as well.
+
+typedef char JudyIndexCheck[JUDY_cache_line < 32 ? -1 : 1];
+
+//    the table of a radix node: outer, flat or index
+
+#define JUDY_table( next ) ( ( JudySlot * )( ( next ) & JUDY_mask & ~( JudySlot )( JUDY_flat | JUDY_index ) ) )
+
+//    the header of an index node follows its 256 index bytes:
+//    the cells in use, the cells handed out so far, and the last
+//    cell freed + 1, or 0.  each freed cell holds the one freed
+//    before it + 1, so neither adding nor deleting a key scans
+//    the index.  the cells follow the header slot.
+
+#define JUDY_index_used( index ) ( ( unsigned char * )( index ) )[256]
+#define JUDY_index_high( index ) ( ( unsigned char * )( index ) )[257]
+#define JUDY_index_freed( index ) ( ( unsigned char * )( index ) )[258]
+#define JUDY_index_cells( index ) ( ( JudySlot * )( ( unsigned char * )( index ) + 256 ) + 1 )
+
+//    the slots after one without a cell that a walk over a radix
+//    node can skip: the rest of its inner table, if it has them
+
+#define JUDY_skip( next ) ( ( next ) & JUDY_index ? 0 : 0x0F )
+
+//    break down an index node waiting on reuse[JUDY_index_reuse]
+//    into the largest linear node blocks it holds
+
+static void judy_index_split( Judy * judy ) {
+    void ** block = judy->reuse[JUDY_index_reuse];
+    unsigned char * index = ( unsigned char * )block;
+    unsigned int amt = JUDY_index_size;
+    int type;
+
+    judy->reuse[JUDY_index_reuse] = *block;
+
+    for( type = JUDY_max; type >= JUDY_1; type-- )
+        for( ; amt >= ( unsigned int )JudySize[type]; index += JudySize[type], amt -= JudySize[type] ) {
+            *( void ** )index = judy->reuse[type];
+            judy->reuse[type] = ( void ** )index;
+        }
+}
+
 //    allocate judy node
 
 void * judy_alloc( Judy * judy, unsigned int type ) {
@@ -184,6 +389,7 @@ void * judy_alloc( Judy * judy, unsigned int type ) {
     if( ( block = judy->reuse[type] ) ) {
         judy->reuse[type] = *block;
         memset( block, 0, amt );
+        JUDY_count( judy, reuseHits );
         return ( void * )block;
     }
 
@@ -199,9 +405,18 @@ void * judy_alloc( Judy * judy, unsigned int type ) {
                     block[JudySize[idx] / sizeof( void * )] = 0;
                 }
                 memset( block, 0, amt );
+                JUDY_count( judy, reuseHits );
                 return ( void * )block;
             }
 
+    //    or break down a freed index node
+
+    if( judy->reuse[JUDY_index_reuse] && amt <= JUDY_index_size ) {
+        judy_index_split( judy );
+        return judy_alloc( judy, type );
+    }
+
+    JUDY_count( judy, reuseMisses );
     min = amt < JUDY_cache_line ? JUDY_cache_line : amt;
 
     if( judy->seg->next < min + sizeof( *seg ) ) {
@@ -210,6 +425,7 @@ void * judy_alloc( Judy * judy, unsigned int type ) {
             seg->seg = judy->seg;
             judy->seg = seg;
             seg->next -= ( JudySlot )seg & ( JUDY_cache_line - 1 );
+            JUDY_count( judy, segments );
         } else {
 #if defined(STANDALONE) || defined(ASKITIS)
             judy_abort( "Out of virtual memory" );
@@ -239,6 +455,11 @@ void * judy_alloc( Judy * judy, unsigned int type ) {
     return ( void * )rtn;
 }
 
+//    allocate data memory for external use.
+//        requests larger than a quarter segment get
+//        a segment of their own, linked in behind
+//        the current one so its free space is kept.
+
 void * judy_data( Judy * judy, unsigned int amt )
 
 {
@@ -256,12 +477,35 @@ void * judy_data( Judy * judy, unsigned int amt )
         amt |= ( JUDY_cache_line - 1 ), amt += 1;
     }
 
+    if( amt > JUDY_seg / 4 ) {
+        if( ( seg = malloc( amt + JUDY_cache_line + sizeof( *seg ) ) ) ) {
+            seg->next = 0;
+            seg->seg = judy->seg->seg;
+            judy->seg->seg = seg;
+            JUDY_count( judy, segments );
+        } else {
+#if defined(STANDALONE) || defined(ASKITIS)
+            judy_abort( "Out of virtual memory" );
+#else
+            return NULL;
+#endif
+        }
+
+#if defined(STANDALONE) || defined(ASKITIS)
+        MaxMem += amt + JUDY_cache_line + sizeof( *seg );
+#endif
+        block = ( void * )( ( ( JudySlot )( seg + 1 ) + JUDY_cache_line - 1 ) & ~( JudySlot )( JUDY_cache_line - 1 ) );
+        memset( block, 0, amt );
+        return block;
+    }
+
     if( judy->seg->next < amt + sizeof( *seg ) ) {
         if( ( seg = malloc( JUDY_seg ) ) ) {
             seg->next = JUDY_seg;
             seg->seg = judy->seg;
             judy->seg = seg;
             seg->next -= ( JudySlot )seg & ( JUDY_cache_line - 1 );
+            JUDY_count( judy, segments );
         } else {
 #if defined(STANDALONE) || defined(ASKITIS)
             judy_abort( "Out of virtual memory" );
@@ -290,9 +534,39 @@ Judy * judy_clone( Judy * judy ) {
     clone = judy_data( judy, amt );
     memcpy( clone, judy, amt );
     clone->seg = NULL;    // stop allocations from cloned array
+#ifdef JUDY_INSTRUMENT
+    memset( &clone->counters, 0, sizeof( clone->counters ) );
+#endif
     return clone;
 }
 
+//    open a cursor: a copy of the judy object and its stack,
+//    allocated on the heap so that it can be closed again
+//    without waiting for judy_close.  A cursor may be passed
+//    to judy_strt, judy_slot, judy_key, judy_end, judy_nxt and
+//    judy_prv; it is invalidated by any change to the array.
+
+Judy * judy_cursor( Judy * judy ) {
+    Judy * cursor;
+    unsigned int amt;
+
+    amt = sizeof( Judy ) + judy->max * sizeof( JudyStack );
+
+    if( ( cursor = malloc( amt ) ) ) {
+        memcpy( cursor, judy, amt );
+        cursor->seg = NULL;    // stop allocations from the cursor
+#ifdef JUDY_INSTRUMENT
+        memset( &cursor->counters, 0, sizeof( cursor->counters ) );
+#endif
+    }
+
+    return cursor;
+}
+
+void judy_cursor_close( Judy * cursor ) {
+    free( cursor );
+}
+
 void judy_free( Judy * judy, void * block, int type ) {
     if( type == JUDY_radix ) {
         type = JUDY_radix_equiv;
@@ -309,11 +583,179 @@ void judy_free( Judy * judy, void * block, int type ) {
     return;
 }
 
-//    assemble key from current path
+//    allocate and free flat radix nodes, which are
+//    kept on reuse[JUDY_radix]: other radix tables
+//    are JUDY_radix_equiv nodes.
 
-unsigned int judy_key( Judy * judy, unsigned char * buff, unsigned int max ) {
+static JudySlot * judy_flat_alloc( Judy * judy ) {
+    void ** block;
+
+    if( ( block = judy->reuse[JUDY_radix] ) ) {
+        judy->reuse[JUDY_radix] = *block;
+        memset( block, 0, JUDY_flat_size );
+        JUDY_count( judy, reuseHits );
+        return ( JudySlot * )block;
+    }
+
+    return judy_data( judy, JUDY_flat_size );
+}
+
+static void judy_flat_free( Judy * judy, JudySlot * table ) {
+    *( void ** )table = judy->reuse[JUDY_radix];
+    judy->reuse[JUDY_radix] = ( void ** )table;
+}
+
+//    make the two-level radix node in *next flat
+//    once JUDY_flat_tables of its inner tables are in use
+
+static void judy_flatten( Judy * judy, JudySlot * next ) {
+    JudySlot * table = JUDY_table( *next ), *inner, *flat;
+    int idx, cnt = 0;
+
+    for( idx = 0; idx < 16; idx++ )
+        if( table[idx] ) {
+            cnt++;
+        }
+
+    if( cnt < JUDY_flat_tables || !( flat = judy_flat_alloc( judy ) ) ) {
+        return;
+    }
+
+    for( idx = 0; idx < 16; idx++ )
+        if( ( inner = ( JudySlot * )( table[idx] & JUDY_mask ) ) ) {
+            memcpy( flat + idx * 16, inner, 16 * sizeof( JudySlot ) );
+            judy_free( judy, inner, JUDY_radix );
+        }
+
+    judy_free( judy, table, JUDY_radix );
+    *next = ( JudySlot )flat | JUDY_radix | JUDY_flat;
+    JUDY_count( judy, flattens );
+}
+
+//    allocate and free index nodes, which are
+//    kept on reuse[JUDY_index_reuse]
+
+static unsigned char * judy_index_alloc( Judy * judy ) {
+    void ** block;
+
+    if( ( block = judy->reuse[JUDY_index_reuse] ) ) {
+        judy->reuse[JUDY_index_reuse] = *block;
+        memset( block, 0, JUDY_index_size );
+        JUDY_count( judy, reuseHits );
+        return ( unsigned char * )block;
+    }
+
+    return judy_data( judy, JUDY_index_size );
+}
+
+static void judy_index_free( Judy * judy, unsigned char * index ) {
+    *( void ** )index = judy->reuse[JUDY_index_reuse];
+    judy->reuse[JUDY_index_reuse] = ( void ** )index;
+}
+
+//    the cell for byte slot in radix node next, or NULL when an
+//    index node has no slot for it, or a two-level node has no
+//    inner table for it
+
+static JudySlot * judy_radix_cell( JudySlot next, int slot ) {
+    JudySlot * table = JUDY_table( next ), *inner;
+    unsigned char * index;
+
+    if( next & JUDY_index ) {
+        index = ( unsigned char * )table;
+        return index[slot] ? JUDY_index_cells( index ) + index[slot] - 1 : NULL;
+    }
+
+    if( next & JUDY_flat ) {
+        return table + slot;
+    }
+
+    if( ( inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask ) ) ) {
+        return inner + ( slot & 0x0F );
+    }
+
+    return NULL;
+}
+
+//    turn the full index node in *next into a two-level radix node
+
+static void judy_expand( Judy * judy, JudySlot * next ) {
+    unsigned char * index = ( unsigned char * )JUDY_table( *next );
+    JudySlot * cells = JUDY_index_cells( index ), *table, *inner;
+    int slot;
+
+    table = judy_alloc( judy, JUDY_radix );
+
+    for( slot = 0; slot < 256; slot++ ) {
+        if( !index[slot] || !cells[index[slot] - 1] ) {
+            continue;
+        }
+
+        if( !( inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask ) ) ) {
+            inner = judy_alloc( judy, JUDY_radix );
+            table[slot >> 4] = ( JudySlot )inner | JUDY_radix;
+        }
+
+        inner[slot & 0x0F] = cells[index[slot] - 1];
+    }
+
+    judy_index_free( judy, index );
+    *next = ( JudySlot )table | JUDY_radix;
+    JUDY_count( judy, promotes[JUDY_radix] );
+    judy_flatten( judy, next );
+}
+
+//    the cell for byte slot in radix node *next, made if need be:
+//    an index node gives slot the last cell freed, or the next one
+//    never used, and is expanded once all are in use; a two-level
+//    node gets the inner table, and is made flat once most are in use.
+
+static JudySlot * judy_radix_add( Judy * judy, JudySlot * next, int slot ) {
+    JudySlot * table = JUDY_table( *next ), *cells;
+    unsigned char * index;
+    int cell;
+
+    if( *next & JUDY_index ) {
+        index = ( unsigned char * )table;
+        cells = JUDY_index_cells( index );
+
+        if( index[slot] ) {
+            return cells + index[slot] - 1;
+        }
+
+        if( JUDY_index_used( index ) < JUDY_index_slots ) {
+            if( ( cell = JUDY_index_freed( index ) ) ) {
+                JUDY_index_freed( index ) = ( unsigned char )cells[cell - 1];
+                cells[cell - 1] = 0;
+            } else {
+                cell = ++JUDY_index_high( index );
+            }
+
+            JUDY_index_used( index )++;
+            index[slot] = cell;
+            return cells + cell - 1;
+        }
+
+        judy_expand( judy, next );
+        table = JUDY_table( *next );
+    }
+
+    if( !( *next & JUDY_flat ) && !table[slot >> 4] ) {
+        table[slot >> 4] = ( JudySlot )judy_alloc( judy, JUDY_radix ) | JUDY_radix;
+        judy_flatten( judy, next );
+    }
+
+    return judy_radix_cell( *next, slot );
+}
+
+//    assemble key from current path,
+//    starting at stack level idx: the bytes
+//    of the key before stack[idx].off are
+//    taken to be in buff already.
+
+static unsigned int judy_keyfrom( Judy * judy, unsigned char * buff, unsigned int max, unsigned int idx ) {
     judyvalue * dest = ( judyvalue * )buff;
-    unsigned int len = 0, idx = 0, depth;
+    unsigned int len = idx > 1 ? judy->stack[idx].off : 0, depth;
     int slot, off, type;
     judyvalue value;
     unsigned char * base;
@@ -325,6 +767,18 @@ unsigned int judy_key( Judy * judy, unsigned char * buff, unsigned int max ) {
         max--;    // leave room for zero terminator
     }
 
+    if( len > max ) {
+        len = max;
+    }
+
+    //  clear the rest of a partly rebuilt integer
+
+    if( judy->depth && len & JUDY_key_mask ) {
+        dest[len / JUDY_key_size] &= ~JudyMask[JUDY_key_size - ( len & JUDY_key_mask )];
+    }
+
+    idx--;
+
     while( len < max && ++idx <= judy->level ) {
         type = judy->stack[idx].next & 0x07;
         slot = judy->stack[idx].slot;
@@ -382,7 +836,7 @@ unsigned int judy_key( Judy * judy, unsigned char * buff, unsigned int max ) {
 
             case JUDY_radix:
                 if( judy->depth ) {
-                    dest[depth] |= ( judyvalue )slot << ( JUDY_key_size - ( ++len & JUDY_key_mask ) ) * 8;
+                    dest[depth] |= ( judyvalue )slot << ( JUDY_key_size - 1 - ( len++ & JUDY_key_mask ) ) * 8;
                     if( !( len & JUDY_key_mask ) ) {
                         depth++;
                     }
@@ -390,36 +844,509 @@ unsigned int judy_key( Judy * judy, unsigned char * buff, unsigned int max ) {
                         continue;
                     }
 
-                    return len;
-                }
+                    return len;
+                }
+
+                if( !slot ) {
+                    break;
+                }
+                buff[len++] = ( unsigned char )slot;
+                continue;
+
+#ifndef ASKITIS
+            case JUDY_span:
+                base = ( unsigned char * )( judy->stack[idx].next & JUDY_mask );
+
+                for( slot = 0; slot < JUDY_span_bytes && base[slot]; slot++ )
+                    if( len < max ) {
+                        buff[len++] = base[slot];
+                    }
+                continue;
+#endif
+        }
+    }
+    buff[len] = 0;
+    return len;
+}
+
+unsigned int judy_key( Judy * judy, unsigned char * buff, unsigned int max ) {
+    return judy_keyfrom( judy, buff, max, 1 );
+}
+
+//    find slot & setup cursor, descending from node next,
+//    which starts at byte off (integer depth) of the key,
+//    pushing onto the stack above the current level
+
+static JudySlot * judy_descend( Judy * judy, const unsigned char * buff, unsigned int max, JudySlot next, unsigned int off, unsigned int depth ) {
+    judyvalue * src = ( judyvalue * )buff;
+    int slot, size, keysize, cnt;
+#ifndef ASKITIS
+    int tst;
+#endif
+    judyvalue value, test = 0;
+    JudySlot * table;
+    JudySlot * node;
+    unsigned char * base;
+
+    while( next ) {
+#ifndef ASKITIS
+        if( judy->level < judy->max ) {
+            judy->level++;
+        }
+
+        judy->stack[judy->level].next = next;
+        judy->stack[judy->level].off = off;
+#endif
+        size = JudySize[next & 0x07];
+
+        switch( next & 0x07 ) {
+
+            case JUDY_1:
+            case JUDY_2:
+            case JUDY_4:
+            case JUDY_8:
+            case JUDY_16:
+            case JUDY_32:
+#ifdef ASKITIS
+            case JUDY_64:
+#endif
+                base = ( unsigned char * )( next & JUDY_mask );
+                node = ( JudySlot * )( ( next & JUDY_mask ) + size );
+                keysize = JUDY_key_size - ( off & JUDY_key_mask );
+                cnt = size / ( sizeof( JudySlot ) + keysize );
+                value = 0;
+
+                if( judy->depth ) {
+                    value = src[depth++];
+                    off |= JUDY_key_mask;
+                    off++;
+                    value &= JudyMask[keysize];
+                } else
+                    do {
+                        value <<= 8;
+                        if( off < max ) {
+                            value |= buff[off];
+                        }
+                    } while( ++off & JUDY_key_mask );
+
+                //  find slot > key
+
+                slot = judy_search( base, cnt, keysize, value, &test );
+                JUDY_lines( judy, base, size, cnt, keysize, slot, test == value );
+#ifndef ASKITIS
+                judy->stack[judy->level].slot = slot;
+#endif
+                if( test == value ) {
+
+                    // is this a leaf?
+
+                    if( !judy->depth && !( value & 0xFF ) || judy->depth && depth == judy->depth ) {
+                        return &node[-slot - 1];
+                    }
+
+                    next = node[-slot - 1];
+                    continue;
+                }
+
+                return NULL;
+
+            case JUDY_radix:
+                if( judy->depth ) {
+                    slot = ( src[depth] >> ( ( JUDY_key_size - ++off & JUDY_key_mask ) * 8 ) ) & 0xff;
+                } else if( off < max ) {
+                    slot = buff[off++];
+                } else {
+                    slot = 0;
+                }
+#ifndef ASKITIS
+                //    put radix slot on judy stack
+
+                judy->stack[judy->level].slot = slot;
+#endif
+                if( !( table = judy_radix_cell( next, slot ) ) ) {
+                    return NULL;
+                }
+
+                if( judy->depth )
+                    if( !( off & JUDY_key_mask ) ) {
+                        depth++;
+                    }
+
+                if( !judy->depth && !slot || judy->depth && depth == judy->depth )    // leaf?
+                    if( *table ) {  // occupied?
+                        return table;
+                    } else {
+                        return NULL;
+                    }
+
+                next = *table;
+                continue;
+
+#ifndef ASKITIS
+            case JUDY_span:
+                node = ( JudySlot * )( ( next & JUDY_mask ) + JudySize[JUDY_span] );
+                base = ( unsigned char * )( next & JUDY_mask );
+                cnt = tst = JUDY_span_bytes;
+                if( tst > ( int )( max - off ) ) {
+                    tst = max - off;
+                }
+                value = strncmp( ( const char * )base, ( const char * )( buff + off ), tst );
+                if( !value && tst < cnt && !base[tst] ) { // leaf?
+                    return &node[-1];
+                }
+
+                if( !value && tst == cnt ) {
+                    next = node[-1];
+                    off += cnt;
+                    continue;
+                }
+                return NULL;
+#endif
+        }
+    }
+
+    return NULL;
+}
+
+JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max ) {
+    JudySlot * cell;
+
+#ifndef ASKITIS
+    judy->level = 0;
+#endif
+    cell = judy_descend( judy, buff, max, *judy->root, 0, 0 );
+    return JUDY_lookup( judy, judy->level, cell );
+}
+
+#ifndef ASKITIS
+//    does the key in buff take the same branch out of the node
+//    at stack level idx as the current key?
+
+static int judy_match( Judy * judy, unsigned int idx, const unsigned char * buff, unsigned int max ) {
+    const judyvalue * src = ( const judyvalue * )buff;
+    JudySlot next = judy->stack[idx].next;
+    unsigned int off = judy->stack[idx].off;
+    int slot = judy->stack[idx].slot;
+    int keysize;
+    judyvalue value, test;
+    unsigned char * base;
+
+    switch( next & 0x07 ) {
+        case JUDY_1:
+        case JUDY_2:
+        case JUDY_4:
+        case JUDY_8:
+        case JUDY_16:
+        case JUDY_32:
+            if( slot < 0 ) {
+                return 0;
+            }
+            base = ( unsigned char * )( next & JUDY_mask );
+            keysize = JUDY_key_size - ( off & JUDY_key_mask );
+            test = *( judyvalue * )( base + slot * keysize );
+#if BYTE_ORDER == BIG_ENDIAN
+            test >>= 8 * ( JUDY_key_size - keysize );
+#else
+            test &= JudyMask[keysize];
+#endif
+            if( judy->depth ) {
+                return test == ( src[off / JUDY_key_size] & JudyMask[keysize] );
+            }
+            value = 0;
+            do {
+                value <<= 8;
+                if( off < max ) {
+                    value |= buff[off];
+                }
+            } while( ++off & JUDY_key_mask );
+            return test == value;
+
+        case JUDY_radix:
+            if( judy->depth ) {
+                value = ( src[off / JUDY_key_size] >> ( ( JUDY_key_size - 1 - ( off & JUDY_key_mask ) ) * 8 ) ) & 0xff;
+            } else {
+                value = off < max ? buff[off] : 0;
+            }
+            return value == ( judyvalue )slot;
+
+        case JUDY_span:
+            base = ( unsigned char * )( next & JUDY_mask );
+            if( off + JUDY_span_bytes > max ) {
+                return 0;
+            }
+            return !strncmp( ( const char * )base, ( const char * )( buff + off ), JUDY_span_bytes );
+    }
+    return 0;
+}
+
+//    the cell in the node at stack level idx - 1
+//    that points to the node at level idx
+
+static JudySlot * judy_parent( Judy * judy, unsigned int idx ) {
+    JudySlot next;
+    int slot;
+
+    if( idx == 1 ) {
+        return judy->root;
+    }
+
+    next = judy->stack[idx - 1].next;
+    slot = judy->stack[idx - 1].slot;
+
+    switch( next & 0x07 ) {
+        case JUDY_radix:
+            return judy_radix_cell( next, slot );
+        case JUDY_span:
+            return ( JudySlot * )( ( next & JUDY_mask ) + JudySize[JUDY_span] ) - 1;
+        default:
+            return ( JudySlot * )( ( next & JUDY_mask ) + JudySize[next & 0x07] ) - slot - 1;
+    }
+}
+
+//    demote the linear node at the top of the stack to the
+//    next smaller size once it is under a quarter full.
+//    the node is then under half full, so it takes many
+//    inserts before judy_promote grows it again.
+
+static void judy_demote( Judy * judy ) {
+    JudySlot next = judy->stack[judy->level].next;
+    unsigned int off = judy->stack[judy->level].off;
+    int keysize = JUDY_key_size - ( off & JUDY_key_mask );
+    int type = next & 0x07;
+    int cnt = JudySize[type] / ( sizeof( JudySlot ) + keysize );
+    int newcnt = JudySize[type - 1] / ( sizeof( JudySlot ) + keysize );
+    unsigned char * base = ( unsigned char * )( next & JUDY_mask );
+    JudySlot * node = ( JudySlot * )( base + JudySize[type] );
+    unsigned char * newbase;
+    JudySlot * newnode;
+    int first, idx;
+
+    //    keys are packed at the top; is the slot a quarter from the top empty?
+
+    if( type == JUDY_1 || node[-( cnt - ( cnt + 3 ) / 4 ) - 1] ) {
+        return;
+    }
+
+    for( first = 0; !node[-first - 1]; first++ );
+
+    if( cnt - first > newcnt ) {
+        return;
+    }
+
+    if( !( newbase = judy_alloc( judy, type - 1 ) ) ) {
+        return;
+    }
+
+    newnode = ( JudySlot * )( newbase + JudySize[type - 1] );
+    memcpy( newbase + ( newcnt - cnt + first ) * keysize, base + first * keysize, ( cnt - first ) * keysize );
+
+    for( idx = first; idx < cnt; idx++ ) {
+        newnode[-( idx + newcnt - cnt ) - 1] = node[-idx - 1];
+    }
+
+    *judy_parent( judy, judy->level ) = ( JudySlot )newbase | ( type - 1 );
+    judy->stack[judy->level].next = ( JudySlot )newbase | ( type - 1 );
+    judy->stack[judy->level].slot += newcnt - cnt;
+    judy_free( judy, base, type );
+    JUDY_count( judy, demotes );
+}
+
+//    free the tables of radix node next, of any kind
+
+static void judy_radix_free( Judy * judy, JudySlot next ) {
+    JudySlot * table = JUDY_table( next ), *inner;
+    int idx;
+
+    if( next & JUDY_index ) {
+        judy_index_free( judy, ( unsigned char * )table );
+        return;
+    }
+
+    if( next & JUDY_flat ) {
+        judy_flat_free( judy, table );
+        return;
+    }
+
+    for( idx = 0; idx < 16; idx++ )
+        if( ( inner = ( JudySlot * )( table[idx] & JUDY_mask ) ) ) {
+            judy_free( judy, inner, JUDY_radix );
+        }
+
+    judy_free( judy, table, JUDY_radix );
+}
+
+//    merge the radix node at the top of the stack back into a
+//    linear node, undoing judy_splitnode, when its children are
+//    leaves or linear nodes and their keys would fill no more
+//    than a quarter of the largest linear node.  that leaves
+//    three quarters of it to fill before it is split again.
+//    the stack is left for judy_prv to find the key before slot.
+
+static void judy_collapse( Judy * judy, int slot ) {
+    JudySlot next = judy->stack[judy->level].next;
+    unsigned int off = judy->stack[judy->level].off;
+    int keysize = JUDY_key_size - ( off & JUDY_key_mask );
+    int max = JudySize[JUDY_max] / ( sizeof( JudySlot ) + keysize );
+    JudySlot * cell, *node, *child;
+    unsigned char * base, *src;
+    int key, cnt = 0, before = 0, newcnt, idx, first, ccnt, type, ctype;
+
+    //    each child holds at least one key, so a radix node
+    //    with too many children is given up on without
+    //    reading them
+
+    for( key = 0; key < 256; key++ ) {
+        if( !( cell = judy_radix_cell( next, key ) ) ) {
+            key |= JUDY_skip( next );
+            continue;
+        }
+
+        if( *cell && ++cnt * 4 > max ) {
+            return;
+        }
+    }
+
+    cnt = 0;
+
+    //    count the keys below the radix node
+
+    for( key = 0; key < 256; key++ ) {
+        if( !( cell = judy_radix_cell( next, key ) ) ) {
+            key |= JUDY_skip( next );
+            continue;
+        }
+
+        if( !*cell ) {
+            continue;
+        }
+
+        if( keysize == 1 || ( !judy->depth && !key ) ) {
+            idx = 1;    // leaf, or node for the next word
+        } else {
+            ctype = *cell & 0x07;
+            if( ctype < JUDY_1 || ctype > JUDY_max ) {
+                return;
+            }
+            ccnt = JudySize[ctype] / ( sizeof( JudySlot ) + keysize - 1 );
+            child = ( JudySlot * )( ( *cell & JUDY_mask ) + JudySize[ctype] );
+            for( first = 0; first < ccnt && !child[-first - 1]; first++ );
+            idx = ccnt - first;
+        }
+
+        if( ( cnt += idx ) * 4 > max ) {
+            return;
+        }
+
+        if( key < slot ) {
+            before += idx;
+        }
+    }
+
+    for( type = JUDY_1; ( newcnt = JudySize[type] / ( sizeof( JudySlot ) + keysize ) ) < cnt; type++ );
+
+    if( !cnt || !( base = judy_alloc( judy, type ) ) ) {
+        return;
+    }
+
+    node = ( JudySlot * )( base + JudySize[type] );
+    idx = newcnt - cnt;
+
+    //    copy the keys in order, putting the radix byte in front
+
+    for( key = 0; key < 256; key++ ) {
+        if( !( cell = judy_radix_cell( next, key ) ) ) {
+            key |= JUDY_skip( next );
+            continue;
+        }
+
+        if( *cell ) {
+            if( keysize == 1 || ( !judy->depth && !key ) ) {
+#if BYTE_ORDER != BIG_ENDIAN
+                base[idx * keysize + keysize - 1] = key;
+#else
+                base[idx * keysize] = key;
+#endif
+                node[-idx - 1] = *cell;
+                idx++;
+            } else {
+                ctype = *cell & 0x07;
+                ccnt = JudySize[ctype] / ( sizeof( JudySlot ) + keysize - 1 );
+                src = ( unsigned char * )( *cell & JUDY_mask );
+                child = ( JudySlot * )( src + JudySize[ctype] );
+                for( first = 0; !child[-first - 1]; first++ );
+                for( ; first < ccnt; first++, idx++ ) {
+#if BYTE_ORDER != BIG_ENDIAN
+                    memcpy( base + idx * keysize, src + first * ( keysize - 1 ), keysize - 1 );
+                    base[idx * keysize + keysize - 1] = key;
+#else
+                    base[idx * keysize] = key;
+                    memcpy( base + idx * keysize + 1, src + first * ( keysize - 1 ), keysize - 1 );
+#endif
+                    node[-idx - 1] = child[-first - 1];
+                }
+                judy_free( judy, src, ctype );
+            }
+        }
+    }
+
+    judy_radix_free( judy, next );
+
+    *judy_parent( judy, judy->level ) = ( JudySlot )base | type;
+    judy->stack[judy->level].next = ( JudySlot )base | type;
+    judy->stack[judy->level].slot = newcnt - cnt + before;
+    JUDY_count( judy, collapses );
+}
+#endif
+
+//    finger search: retrieve the cell pointer greater than or equal
+//    to given key, as judy_strt does, but starting from the current
+//    stack.  the levels on which the new key branches the same way as
+//    the current key are kept, and the descent resumes below them, so
+//    a run of nearby keys in order costs much less than a descent from
+//    the root for each.  the stack must come from judy_strt, judy_slot,
+//    judy_end, judy_nxt, judy_prv or judy_seek, with no change to the
+//    array since; a level of zero starts from the root.
+
+JudySlot * judy_seek( Judy * judy, const unsigned char * buff, unsigned int max ) {
+#ifndef ASKITIS
+    unsigned int idx = 1, off;
+    JudySlot * cell;
+
+    if( !max || !judy->level ) {
+        return judy_strt( judy, buff, max );
+    }
 
-                if( !slot ) {
-                    break;
-                }
-                buff[len++] = ( unsigned char )slot;
-                continue;
+    while( idx < judy->level && judy_match( judy, idx, buff, max ) ) {
+        idx++;
+    }
 
-#ifndef ASKITIS
-            case JUDY_span:
-                base = ( unsigned char * )( judy->stack[idx].next & JUDY_mask );
+    off = judy->stack[idx].off;
+    judy->level = idx - 1;
 
-                for( slot = 0; slot < JUDY_span_bytes && base[slot]; slot++ )
-                    if( len < max ) {
-                        buff[len++] = base[slot];
-                    }
-                continue;
-#endif
-        }
+    cell = judy_descend( judy, buff, max, judy->stack[idx].next, off, off / JUDY_key_size );
+
+    if( JUDY_lookup( judy, judy->level, cell ) ) {
+        return cell;
     }
-    buff[len] = 0;
-    return len;
+
+    return judy_nxt( judy );
+#else
+    return judy_strt( judy, buff, max );
+#endif
 }
 
-//    find slot & setup cursor
+//    retrieve the cell pointer, or return NULL for a given key,
+//    as judy_slot does, but without touching the judy stack.
+//    the array is only read, so any number of threads may call
+//    judy_get on one array at once, as long as none changes it
+//    (and, with JUDY_INSTRUMENT, each reads through a clone).
 
-JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max ) {
-    judyvalue * src = ( judyvalue * )buff;
-    int slot, size, keysize, tst, cnt;
+JudySlot * judy_get( const Judy * judy, const unsigned char * buff, unsigned int max ) {
+    const judyvalue * src = ( const judyvalue * )buff;
+    int slot, size, keysize, cnt;
+#ifndef ASKITIS
+    int tst;
+#endif
     JudySlot next = *judy->root;
     judyvalue value, test = 0;
     JudySlot * table;
@@ -427,19 +1354,13 @@ JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max
     unsigned int depth = 0;
     unsigned int off = 0;
     unsigned char * base;
-
-#ifndef ASKITIS
-    judy->level = 0;
+#ifdef JUDY_INSTRUMENT
+    unsigned int levels = 0;
 #endif
 
     while( next ) {
-#ifndef ASKITIS
-        if( judy->level < judy->max ) {
-            judy->level++;
-        }
-
-        judy->stack[judy->level].next = next;
-        judy->stack[judy->level].off = off;
+#ifdef JUDY_INSTRUMENT
+        levels++;
 #endif
         size = JudySize[next & 0x07];
 
@@ -458,7 +1379,6 @@ JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max
                 node = ( JudySlot * )( ( next & JUDY_mask ) + size );
                 keysize = JUDY_key_size - ( off & JUDY_key_mask );
                 cnt = size / ( sizeof( JudySlot ) + keysize );
-                slot = cnt;
                 value = 0;
 
                 if( judy->depth ) {
@@ -476,68 +1396,49 @@ JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max
 
                 //  find slot > key
 
-                while( slot-- ) {
-                    test = *( judyvalue * )( base + slot * keysize );
-#if BYTE_ORDER == BIG_ENDIAN
-                    test >>= 8 * ( JUDY_key_size - keysize );
-#else
-                    test &= JudyMask[keysize];
-#endif
-                    if( test <= value ) {
-                        break;
-                    }
-                }
-#ifndef ASKITIS
-                judy->stack[judy->level].slot = slot;
-#endif
+                slot = judy_search( base, cnt, keysize, value, &test );
+                JUDY_lines( judy, base, size, cnt, keysize, slot, test == value );
+
                 if( test == value ) {
 
                     // is this a leaf?
 
-                    if( !judy->depth && !( value & 0xFF ) || judy->depth && depth == judy->depth ) {
-                        return &node[-slot - 1];
+                    if( ( !judy->depth && !( value & 0xFF ) ) || ( judy->depth && depth == judy->depth ) ) {
+                        return JUDY_lookup( judy, levels, &node[-slot - 1] );
                     }
 
                     next = node[-slot - 1];
                     continue;
                 }
 
-                return NULL;
+                return JUDY_lookup( judy, levels, NULL );
 
             case JUDY_radix:
-                table = ( JudySlot * )( next & JUDY_mask ); // outer radix
-
                 if( judy->depth ) {
-                    slot = ( src[depth] >> ( ( JUDY_key_size - ++off & JUDY_key_mask ) * 8 ) ) & 0xff;
+                    slot = ( src[depth] >> ( ( ( JUDY_key_size - ++off ) & JUDY_key_mask ) * 8 ) ) & 0xff;
                 } else if( off < max ) {
                     slot = buff[off++];
                 } else {
                     slot = 0;
                 }
-#ifndef ASKITIS
-                //    put radix slot on judy stack
 
-                judy->stack[judy->level].slot = slot;
-#endif
-                if( ( next = table[slot >> 4] ) ) {
-                    table = ( JudySlot * )( next & JUDY_mask );    // inner radix
-                } else {
-                    return NULL;
+                if( !( table = judy_radix_cell( next, slot ) ) ) {
+                    return JUDY_lookup( judy, levels, NULL );
                 }
 
-                if( judy->depth )
-                    if( !( off & JUDY_key_mask ) ) {
-                        depth++;
-                    }
+                if( judy->depth && !( off & JUDY_key_mask ) ) {
+                    depth++;
+                }
 
-                if( !judy->depth && !slot || judy->depth && depth == judy->depth )    // leaf?
-                    if( table[slot & 0x0F] ) {  // occupied?
-                        return &table[slot & 0x0F];
+                if( ( !judy->depth && !slot ) || ( judy->depth && depth == judy->depth ) ) { // leaf?
+                    if( *table ) {  // occupied?
+                        return JUDY_lookup( judy, levels, table );
                     } else {
-                        return NULL;
+                        return JUDY_lookup( judy, levels, NULL );
                     }
+                }
 
-                next = table[slot & 0x0F];
+                next = *table;
                 continue;
 
 #ifndef ASKITIS
@@ -550,7 +1451,7 @@ JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max
                 }
                 value = strncmp( ( const char * )base, ( const char * )( buff + off ), tst );
                 if( !value && tst < cnt && !base[tst] ) { // leaf?
-                    return &node[-1];
+                    return JUDY_lookup( judy, levels, &node[-1] );
                 }
 
                 if( !value && tst == cnt ) {
@@ -558,12 +1459,12 @@ JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max
                     off += cnt;
                     continue;
                 }
-                return NULL;
+                return JUDY_lookup( judy, levels, NULL );
 #endif
         }
     }
 
-    return NULL;
+    return JUDY_lookup( judy, levels, NULL );
 }
 
 //    promote full nodes to next larger size
@@ -589,6 +1490,7 @@ JudySlot * judy_promote( Judy * judy, JudySlot * next, int idx, judyvalue value,
     newbase = judy_alloc( judy, type );
     newnode = ( JudySlot * )( newbase + JudySize[type] );
     *next = ( JudySlot )newbase | type;
+    JUDY_count( judy, promotes[type] );
 
     //    open up slot at idx
 
@@ -629,28 +1531,20 @@ JudySlot * judy_promote( Judy * judy, JudySlot * next, int idx, judyvalue value,
 
 //    construct new node for JUDY_radix entry
 //    make node with slot - start entries
-//    moving key over one offset
+//    moving key over one offset, into cell
 
-void judy_radix( Judy * judy, JudySlot * radix, unsigned char * old, int start, int slot, int keysize, unsigned char key, unsigned int depth ) {
+void judy_radix( Judy * judy, JudySlot * cell, unsigned char * old, int start, int slot, int keysize, unsigned char key, unsigned int depth ) {
     int size, idx, cnt = slot - start, newcnt;
     JudySlot * node, *oldnode;
     unsigned int type = JUDY_1 - 1;
-    JudySlot * table;
     unsigned char * base;
 
-    //    if necessary, setup inner radix node
-
-    if( !( table = ( JudySlot * )( radix[key >> 4] & JUDY_mask ) ) ) {
-        table = judy_alloc( judy, JUDY_radix );
-        radix[key >> 4] = ( JudySlot )table | JUDY_radix;
-    }
-
     oldnode = ( JudySlot * )( old + JudySize[JUDY_max] );
 
     // is this slot a leaf?
 
     if( !judy->depth && ( !key || !keysize ) || judy->depth && !keysize && depth == judy->depth ) {
-        table[key & 0x0F] = oldnode[-start - 1];
+        *cell = oldnode[-start - 1];
         return;
     }
 
@@ -662,11 +1556,11 @@ void judy_radix( Judy * judy, JudySlot * radix, unsigned char * old, int start,
         newcnt = size / ( sizeof( JudySlot ) + keysize );
     } while( cnt > newcnt && type < JUDY_max );
 
-    //    store new node pointer in inner table
+    //    store new node pointer in radix cell
 
     base = judy_alloc( judy, type );
     node = ( JudySlot * )( base + size );
-    table[key & 0x0F] = ( JudySlot )base | type;
+    *cell = ( JudySlot )base | type;
 
     //    allocate node and copy old contents
     //    shorten keys by 1 byte during copy
@@ -684,18 +1578,44 @@ void judy_radix( Judy * judy, JudySlot * radix, unsigned char * old, int start,
 //    decompose full node to radix nodes
 
 void judy_splitnode( Judy * judy, JudySlot * next, unsigned int size, unsigned int keysize, unsigned int depth ) {
-    int cnt, slot, start = 0;
-    unsigned int key = 0x0100, nxt;
-    JudySlot * newradix;
+    int cnt, slot, start = 0, keys = 0, tables = 0;
+    unsigned int key = 0x0100, nxt, nibbles = 0;
     unsigned char * base;
 
     base = ( unsigned char * )( *next & JUDY_mask );
     cnt = size / ( sizeof( JudySlot ) + keysize );
 
-    //    allocate outer judy_radix node
+    //    count the first bytes, and the inner tables
+    //    a two-level radix node would take for them
+
+    for( slot = 0; slot < cnt; slot++ ) {
+#if BYTE_ORDER != BIG_ENDIAN
+        nxt = base[slot * keysize + keysize - 1];
+#else
+        nxt = base[slot * keysize];
+#endif
+        if( nxt != key ) {
+            key = nxt, keys++;
+        }
+        nibbles |= 1 << ( nxt >> 4 );
+    }
+
+    for( ; nibbles; nibbles &= nibbles - 1 ) {
+        tables++;
+    }
+
+    //    allocate an index node, unless there are more first
+    //    bytes than it has slots, or the outer and inner tables
+    //    would be no larger
+
+    if( keys <= JUDY_index_slots && ( tables + 1 ) * JudySize[JUDY_radix] >= JUDY_index_size ) {
+        *next = ( JudySlot )judy_index_alloc( judy ) | JUDY_radix | JUDY_index;
+    } else {
+        *next = ( JudySlot )judy_alloc( judy, JUDY_radix ) | JUDY_radix;
+    }
 
-    newradix = judy_alloc( judy, JUDY_radix );
-    *next = ( JudySlot )newradix | JUDY_radix;
+    JUDY_count( judy, splitnodes );
+    key = 0x0100;
 
     for( slot = 0; slot < cnt; slot++ ) {
 #if BYTE_ORDER != BIG_ENDIAN
@@ -713,19 +1633,107 @@ void judy_splitnode( Judy * judy, JudySlot * next, unsigned int size, unsigned i
 
         //    decompose portion of old node into radix nodes
 
-        judy_radix( judy, newradix, base, start, slot, keysize - 1, ( unsigned char )key, depth );
+        judy_radix( judy, judy_radix_add( judy, next, key ), base, start, slot, keysize - 1, ( unsigned char )key, depth );
         start = slot;
         key = nxt;
     }
 
-    judy_radix( judy, newradix, base, start, slot, keysize - 1, ( unsigned char )key, depth );
+    judy_radix( judy, judy_radix_add( judy, next, key ), base, start, slot, keysize - 1, ( unsigned char )key, depth );
     judy_free( judy, ( void ** )base, JUDY_max );
 }
 
+//    software prefetch for in-order scans: when judy_first or
+//    judy_next goes down into a child that is not a leaf, the next
+//    JUDY_prefetch_ahead siblings after it that are not leaves
+//    either are prefetched, so that their nodes are on the way
+//    while the scan works through the child.  0 turns it off.
+
+#ifndef JUDY_prefetch_ahead
+#  define JUDY_prefetch_ahead 1
+#endif
+
+#if defined(__GNUC__) && JUDY_prefetch_ahead
+#  define JUDY_prefetch( addr ) __builtin_prefetch( ( const void * )( addr ) )
+#else
+#  define JUDY_prefetch( addr )
+#endif
+
+//    prefetch the lines of node next that judy_first reads:
+//    the start of the node, and the top slot of a linear node
+
+static void judy_prefetch( JudySlot next ) {
+    unsigned char * base = ( unsigned char * )( next & JUDY_mask );
+    int type = next & 0x07;
+
+    JUDY_prefetch( base );
+
+    if( type >= JUDY_1 && type <= JUDY_max && JudySize[type] > JUDY_cache_line ) {
+        JUDY_prefetch( base + JudySize[type] - sizeof( JudySlot ) );
+    }
+}
+
+//    prefetch the children a scan will enter after the one at slot
+//    of node next, a linear or radix node whose children are not
+//    all leaves.  radix nodes are searched no further than the next
+//    inner table.
+
+static void judy_ahead( Judy * judy, JudySlot next, int slot, unsigned int off ) {
+#if JUDY_prefetch_ahead
+    int ahead = JUDY_prefetch_ahead, cnt, end, keysize;
+    JudySlot * cell, *node;
+    unsigned char * base;
+
+    switch( next & 0x07 ) {
+        case JUDY_1:
+        case JUDY_2:
+        case JUDY_4:
+        case JUDY_8:
+        case JUDY_16:
+        case JUDY_32:
+#ifdef ASKITIS
+        case JUDY_64:
+#endif
+            keysize = JUDY_key_size - ( off & JUDY_key_mask );
+            cnt = JudySize[next & 0x07] / ( sizeof( JudySlot ) + keysize );
+            base = ( unsigned char * )( next & JUDY_mask );
+            node = ( JudySlot * )( base + JudySize[next & 0x07] );
+
+            while( ++slot < cnt )
+#if BYTE_ORDER != BIG_ENDIAN
+                if( judy->depth || base[slot * keysize] ) {
+#else
+                if( judy->depth || base[slot * keysize + keysize - 1] ) {
+#endif
+                    judy_prefetch( node[-slot - 1] );
+                    if( !--ahead ) {
+                        return;
+                    }
+                }
+            return;
+
+        case JUDY_radix:
+            for( end = ( slot | 0x0F ) + 16; ++slot < 256 && slot <= end; )
+                if( ( cell = judy_radix_cell( next, slot ) ) ) {
+                    if( *cell ) {
+                        judy_prefetch( *cell );
+                        if( !--ahead ) {
+                            return;
+                        }
+                    }
+                } else {
+                    slot |= JUDY_skip( next );
+                }
+            return;
+    }
+#else
+    ( void )judy, ( void )next, ( void )slot, ( void )off;
+#endif
+}
+
 //    return first leaf
 
 JudySlot * judy_first( Judy * judy, JudySlot next, unsigned int off, unsigned int depth ) {
-    JudySlot * table, *inner;
+    JudySlot * cell, radix;
     unsigned int keysize, size;
     JudySlot * node;
     int slot, cnt;
@@ -770,6 +1778,7 @@ JudySlot * judy_first( Judy * judy, JudySlot next, unsigned int off, unsigned in
                     return &node[-slot - 1];
                 }
 #endif
+                judy_ahead( judy, next, slot, off );
                 next = node[-slot - 1];
                 off = ( off | JUDY_key_mask ) + 1;
                 continue;
@@ -781,19 +1790,21 @@ JudySlot * judy_first( Judy * judy, JudySlot next, unsigned int off, unsigned in
                         depth++;
                     }
 
-                table = ( JudySlot * )( next & JUDY_mask );
+                radix = next;
+
                 for( slot = 0; slot < 256; slot++ )
-                    if( ( inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask ) ) ) {
-                        if( ( next = inner[slot & 0x0F] ) ) {
+                    if( ( cell = judy_radix_cell( radix, slot ) ) ) {
+                        if( ( next = *cell ) ) {
                             judy->stack[judy->level].slot = slot;
                             if( !judy->depth && !slot || judy->depth && depth == judy->depth ) {
-                                return &inner[slot & 0x0F];
+                                return cell;
                             } else {
+                                judy_ahead( judy, radix, slot, off );
                                 break;
                             }
                         }
                     } else {
-                        slot |= 0x0F;
+                        slot |= JUDY_skip( radix );
                     }
                 continue;
 #ifndef ASKITIS
@@ -816,10 +1827,13 @@ JudySlot * judy_first( Judy * judy, JudySlot next, unsigned int off, unsigned in
 //    return last leaf cell pointer
 
 JudySlot * judy_last( Judy * judy, JudySlot next, unsigned int off, unsigned int depth ) {
-    JudySlot * table, *inner;
+    JudySlot * cell, radix;
     unsigned int keysize, size;
     JudySlot * node;
-    int slot, cnt;
+    int slot;
+#ifndef ASKITIS
+    int cnt;
+#endif
     unsigned char * base;
 
     while( next ) {
@@ -858,7 +1872,7 @@ JudySlot * judy_last( Judy * judy, JudySlot next, unsigned int off, unsigned int
                 continue;
 
             case JUDY_radix:
-                table = ( JudySlot * )( next & JUDY_mask );
+                radix = next;
                 off++;
 
                 if( judy->depth )
@@ -868,15 +1882,16 @@ JudySlot * judy_last( Judy * judy, JudySlot next, unsigned int off, unsigned int
 
                 for( slot = 256; slot--; ) {
                     judy->stack[judy->level].slot = slot;
-                    if( ( inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask ) ) ) {
-                        if( ( next = inner[slot & 0x0F] ) )
-                            if( !judy->depth && !slot || judy->depth && depth == judy->depth ) {
-                                return &inner[0];
+                    if( ( cell = judy_radix_cell( radix, slot ) ) ) {
+                        if( ( next = *cell ) ) {
+                            if( ( !judy->depth && !slot ) || ( judy->depth && depth == judy->depth ) ) {
+                                return cell;
                             } else {
                                 break;
                             }
+                        }
                     } else {
-                        slot &= 0xF0;
+                        slot &= ~JUDY_skip( radix );
                     }
                 }
                 continue;
@@ -905,9 +1920,11 @@ JudySlot * judy_end( Judy * judy ) {
     return judy_last( judy, *judy->root, 0, 0 );
 }
 
-//    judy_nxt: return next entry
-JudySlot * judy_nxt( Judy * judy ) {
-    JudySlot * table, *inner;
+//    judy_next: return next entry, setting *from
+//    to the lowest stack level that changed
+
+static JudySlot * judy_next( Judy * judy, unsigned int * from ) {
+    JudySlot * cell;
     int slot, size, cnt;
     JudySlot * node;
     JudySlot next;
@@ -917,6 +1934,7 @@ JudySlot * judy_nxt( Judy * judy ) {
     unsigned int off;
 
     if( !judy->level ) {
+        *from = 1;
         return judy_first( judy, *judy->root, 0, 0 );
     }
 
@@ -924,6 +1942,7 @@ JudySlot * judy_nxt( Judy * judy ) {
         next = judy->stack[judy->level].next;
         slot = judy->stack[judy->level].slot;
         off = judy->stack[judy->level].off;
+        *from = judy->level;
         keysize = JUDY_key_size - ( off & JUDY_key_mask );
         size = JudySize[next & 0x07];
         depth = off / JUDY_key_size;
@@ -952,30 +1971,30 @@ JudySlot * judy_nxt( Judy * judy ) {
                         return &node[-slot - 1];
                     } else {
                         judy->stack[judy->level].slot = slot;
+                        judy_ahead( judy, next, slot, off );
                         return judy_first( judy, node[-slot - 1], ( off | JUDY_key_mask ) + 1, depth );
                     }
                 judy->level--;
                 continue;
 
             case JUDY_radix:
-                table = ( JudySlot * )( next & JUDY_mask );
-
                 if( judy->depth )
                     if( !( ( off + 1 ) & JUDY_key_mask ) ) {
                         depth++;
                     }
 
                 while( ++slot < 256 )
-                    if( ( inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask ) ) ) {
-                        if( inner[slot & 0x0F] ) {
+                    if( ( cell = judy_radix_cell( next, slot ) ) ) {
+                        if( *cell ) {
                             judy->stack[judy->level].slot = slot;
                             if( !judy->depth || depth < judy->depth ) {
-                                return judy_first( judy, inner[slot & 0x0F], off + 1, depth );
+                                judy_ahead( judy, next, slot, off );
+                                return judy_first( judy, *cell, off + 1, depth );
                             }
-                            return &inner[slot & 0x0F];
+                            return cell;
                         }
                     } else {
-                        slot |= 0x0F;
+                        slot |= JUDY_skip( next );
                     }
 
                 judy->level--;
@@ -990,17 +2009,19 @@ JudySlot * judy_nxt( Judy * judy ) {
     return NULL;
 }
 
-//    judy_prv: return ptr to previous entry
+//    judy_prev: return ptr to previous entry, setting
+//    *from to the lowest stack level that changed
 
-JudySlot * judy_prv( Judy * judy ) {
+static JudySlot * judy_prev( Judy * judy, unsigned int * from ) {
     int slot, size, keysize;
-    JudySlot * table, *inner;
+    JudySlot * cell;
     JudySlot * node, next;
     unsigned char * base;
     unsigned int depth;
     unsigned int off;
 
     if( !judy->level ) {
+        *from = 1;
         return judy_last( judy, *judy->root, 0, 0 );
     }
 
@@ -1008,6 +2029,7 @@ JudySlot * judy_prv( Judy * judy ) {
         next = judy->stack[judy->level].next;
         slot = judy->stack[judy->level].slot;
         off = judy->stack[judy->level].off;
+        *from = judy->level;
         size = JudySize[next & 0x07];
         depth = off / JUDY_key_size;
 
@@ -1040,8 +2062,6 @@ JudySlot * judy_prv( Judy * judy ) {
                 return judy_last( judy, node[-slot], ( off | JUDY_key_mask ) + 1, depth );
 
             case JUDY_radix:
-                table = ( JudySlot * )( next & JUDY_mask );
-
                 if( judy->depth )
                     if( !( ( off + 1 ) & JUDY_key_mask ) ) {
                         depth++;
@@ -1049,13 +2069,13 @@ JudySlot * judy_prv( Judy * judy ) {
 
                 while( slot-- ) {
                     judy->stack[judy->level].slot--;
-                    if( ( inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask ) ) )
-                        if( inner[slot & 0x0F] )
-                            if( !judy->depth && !slot || judy->depth && depth == judy->depth ) {
-                                return &inner[0];
-                            } else {
-                                return judy_last( judy, inner[slot & 0x0F], off + 1, depth );
-                            }
+                    if( ( cell = judy_radix_cell( next, slot ) ) && *cell ) {
+                        if( ( !judy->depth && !slot ) || ( judy->depth && depth == judy->depth ) ) {
+                            return cell;
+                        } else {
+                            return judy_last( judy, *cell, off + 1, depth );
+                        }
+                    }
                 }
 
                 judy->level--;
@@ -1071,11 +2091,51 @@ JudySlot * judy_prv( Judy * judy ) {
     return NULL;
 }
 
+JudySlot * judy_nxt( Judy * judy ) {
+    unsigned int from;
+
+    return judy_next( judy, &from );
+}
+
+JudySlot * judy_prv( Judy * judy ) {
+    unsigned int from;
+
+    return judy_prev( judy, &from );
+}
+
+//    judy_nxt_key, judy_prv_key: move as judy_nxt
+//    and judy_prv do, and update the key in buff,
+//    which must hold the key of the current entry.
+//    Only the key bytes from the first stack level
+//    that changed onward are rewritten.
+
+JudySlot * judy_nxt_key( Judy * judy, unsigned char * buff, unsigned int max, unsigned int * len ) {
+    unsigned int from;
+    JudySlot * cell = judy_next( judy, &from );
+
+    if( cell ) {
+        *len = judy_keyfrom( judy, buff, max, from );
+    }
+
+    return cell;
+}
+
+JudySlot * judy_prv_key( Judy * judy, unsigned char * buff, unsigned int max, unsigned int * len ) {
+    unsigned int from;
+    JudySlot * cell = judy_prev( judy, &from );
+
+    if( cell ) {
+        *len = judy_keyfrom( judy, buff, max, from );
+    }
+
+    return cell;
+}
+
 //    judy_del: delete string from judy array
 //        returning previous entry.
 
 JudySlot * judy_del( Judy * judy ) {
-    int slot, off, size, type, high;
+    int slot, off, size, type, idx;
     JudySlot * table, *inner;
     JudySlot next, *node;
     int keysize, cnt;
@@ -1117,6 +2177,9 @@ JudySlot * judy_del( Judy * judy ) {
 
                 if( node[-cnt] ) {    // does node have any slots left?
                     judy->stack[judy->level].slot++;
+#ifndef ASKITIS
+                    judy_demote( judy );
+#endif
                     return judy_prv( judy );
                 }
 
@@ -1125,21 +2188,67 @@ JudySlot * judy_del( Judy * judy ) {
                 continue;
 
             case JUDY_radix:
-                table = ( JudySlot * )( next & JUDY_mask );
-                inner = ( JudySlot * )( table[slot >> 4] & JUDY_mask );
-                inner[slot & 0x0F] = 0;
-                high = slot & 0xF0;
+                table = JUDY_table( next );
+                inner = judy_radix_cell( next, slot );
+                *inner = 0;
+
+                //    an index node adds the cell to its
+                //    freed cells, and is freed itself once
+                //    no cell is in use
+
+                if( next & JUDY_index ) {
+                    base = ( unsigned char * )table;
+                    idx = base[slot];
+                    base[slot] = 0;
+
+                    if( !--JUDY_index_used( base ) ) {
+                        judy_index_free( judy, base );
+                        judy->level--;
+                        continue;
+                    }
+
+                    *inner = JUDY_index_freed( base );
+                    JUDY_index_freed( base ) = idx;
+#ifndef ASKITIS
+                    judy_collapse( judy, judy->stack[judy->level].slot );
+#endif
+                    return judy_prv( judy );
+                }
+
+                inner -= slot & 0x0F;
 
                 for( cnt = 16; cnt--; )
                     if( inner[cnt] ) {
+#ifndef ASKITIS
+                        judy_collapse( judy, slot );
+#endif
                         return judy_prv( judy );
                     }
 
+                //    a flat node has no inner tables to free
+
+                if( next & JUDY_flat ) {
+                    for( cnt = 256; cnt--; )
+                        if( table[cnt] ) {
+#ifndef ASKITIS
+                            judy_collapse( judy, slot );
+#endif
+                            return judy_prv( judy );
+                        }
+
+                    judy_flat_free( judy, table );
+                    judy->level--;
+                    continue;
+                }
+
                 judy_free( judy, inner, JUDY_radix );
                 table[slot >> 4] = 0;
 
                 for( cnt = 16; cnt--; )
                     if( table[cnt] ) {
+#ifndef ASKITIS
+                        judy_collapse( judy, slot );
+#endif
                         return judy_prv( judy );
                     }
 
@@ -1174,7 +2283,9 @@ JudySlot * judy_strt( Judy * judy, const unsigned char * buff, unsigned int max
         return judy_first( judy, *judy->root, 0, 0 );
     }
 
-    if( ( cell = judy_slot( judy, buff, max ) ) ) {
+    cell = judy_descend( judy, buff, max, *judy->root, 0, 0 );
+
+    if( JUDY_lookup( judy, judy->level, cell ) ) {
         return cell;
     }
 
@@ -1193,6 +2304,8 @@ void judy_splitspan( Judy * judy, JudySlot * next, unsigned char * base ) {
     int i;
 #endif
 
+    JUDY_count( judy, splitspans );
+
     do {
         newbase = judy_alloc( judy, JUDY_1 );
         *next = ( JudySlot )newbase | JUDY_1;
@@ -1217,25 +2330,23 @@ void judy_splitspan( Judy * judy, JudySlot * next, unsigned char * base ) {
 }
 #endif
 
-//    judy_cell: add string to judy array
+//    judy_insert: add string to judy array, descending from
+//    the cell next, which is reached by byte off (integer depth)
+//    of the key, pushing onto the stack above the current level
 
-JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max ) {
+static JudySlot * judy_insert( Judy * judy, const unsigned char * buff, unsigned int max, JudySlot * next, unsigned int off, unsigned int depth ) {
     judyvalue * src = ( judyvalue * )buff;
-    int size, idx, slot, cnt, tst;
-    JudySlot * next = judy->root;
+    int size, idx, slot, cnt;
+#ifndef ASKITIS
+    int tst;
+#endif
     judyvalue test, value;
-    unsigned int off = 0, start;
+    unsigned int start;
     JudySlot * table;
     JudySlot * node;
-    unsigned int depth = 0;
     unsigned int keysize;
     unsigned char * base;
 
-    judy->level = 0;
-#ifdef ASKITIS
-    Words++;
-#endif
-
     while( *next ) {
 #ifndef ASKITIS
         if( judy->level < judy->max ) {
@@ -1253,7 +2364,6 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
                 base = ( unsigned char * )( *next & JUDY_mask );
                 node = ( JudySlot * )( ( *next & JUDY_mask ) + size );
                 start = off;
-                slot = cnt;
                 value = 0;
 
                 if( judy->depth ) {
@@ -1271,17 +2381,8 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
 
                 //  find slot > key
 
-                while( slot-- ) {
-                    test = *( judyvalue * )( base + slot * keysize );
-#if BYTE_ORDER == BIG_ENDIAN
-                    test >>= 8 * ( JUDY_key_size - keysize );
-#else
-                    test &= JudyMask[keysize];
-#endif
-                    if( test <= value ) {
-                        break;
-                    }
-                }
+                slot = judy_search( base, cnt, keysize, value, &test );
+                JUDY_lines( judy, base, size, cnt, keysize, slot, test == value );
 #ifndef ASKITIS
                 judy->stack[judy->level].slot = slot;
 #endif
@@ -1291,13 +2392,6 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
                     // is this a leaf?
 
                     if( !judy->depth && !( value & 0xFF ) || judy->depth && depth == judy->depth ) {
-#ifdef ASKITIS
-                        if( *next ) {
-                            Found++;
-                        } else {
-                            Inserts++;
-                        }
-#endif
                         return next;
                     }
 
@@ -1327,13 +2421,6 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
                     next = &node[-slot - 1];
 
                     if( !judy->depth && !( value & 0xFF ) || judy->depth && depth == judy->depth ) {
-#ifdef ASKITIS
-                        if( *next ) {
-                            Found++;
-                        } else {
-                            Inserts++;
-                        }
-#endif
                         return next;
                     }
 
@@ -1344,13 +2431,6 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
                     next = judy_promote( judy, next, slot + 1, value, keysize );
 
                     if( !judy->depth && !( value & 0xFF ) || judy->depth && depth == judy->depth ) {
-#ifdef ASKITIS
-                        if( *next ) {
-                            Found++;
-                        } else {
-                            Inserts++;
-                        }
-#endif
                         return next;
                     }
 
@@ -1371,8 +2451,6 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
                 continue;
 
             case JUDY_radix:
-                table = ( JudySlot * )( *next & JUDY_mask ); // outer radix
-
                 if( judy->depth ) {
                     slot = ( src[depth] >> ( ( JUDY_key_size - ++off & JUDY_key_mask ) * 8 ) ) & 0xff;
                 } else if( off < max ) {
@@ -1386,26 +2464,17 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
                         depth++;
                     }
 
-                // allocate inner radix if empty
-
-                if( !table[slot >> 4] ) {
-                    table[slot >> 4] = ( JudySlot )judy_alloc( judy, JUDY_radix ) | JUDY_radix;
-                }
+                // find or make the cell for slot,
+                // which may change the kind of node
 
-                table = ( JudySlot * )( table[slot >> 4] & JUDY_mask );
+                table = judy_radix_add( judy, next, slot );
 #ifndef ASKITIS
+                judy->stack[judy->level].next = *next;
                 judy->stack[judy->level].slot = slot;
 #endif
-                next = &table[slot & 0x0F];
+                next = table;
 
                 if( !judy->depth && !slot || judy->depth && depth == judy->depth ) { // leaf?
-#ifdef ASKITIS
-                    if( *next ) {
-                        Found++;
-                    } else {
-                        Inserts++;
-                    }
-#endif
                     return next;
                 }
 
@@ -1553,9 +2622,57 @@ JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max
         }
 #endif
 
+    return next;
+}
+
+//    judy_cell: add string to judy array
+
+JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max ) {
+    JudySlot * cell;
+
+    judy->level = 0;
+    cell = judy_insert( judy, buff, max, judy->root, 0, 0 );
+    JUDY_inserted( judy, cell );
+#ifdef ASKITIS
+    Words++;
+
+    if( *cell ) {
+        Found++;
+    } else {
+        Inserts++;
+    }
+#endif
+    return cell;
+}
+
+//    judy_append: add string to judy array, as judy_cell does,
+//    but resuming from the current stack: the levels on which the
+//    new key branches the same way as the current key are kept.
+//    keys inserted in ascending order share all but the last
+//    levels with the key inserted before, so bulk loading sorted
+//    keys (timestamps, sequence numbers) skips most of the descent.
+//    a key out of order costs what judy_cell would.
+
+JudySlot * judy_append( Judy * judy, const unsigned char * buff, unsigned int max ) {
 #ifdef ASKITIS
-    Inserts++;
+    return judy_cell( judy, buff, max );
+#else
+    unsigned int idx = 1, off;
+    JudySlot * cell;
+
+    if( !judy->level ) {
+        return judy_cell( judy, buff, max );
+    }
+
+    while( idx < judy->level && judy_match( judy, idx, buff, max ) ) {
+        idx++;
+    }
+
+    off = judy->stack[idx].off;
+    judy->level = idx - 1;
+    cell = judy_insert( judy, buff, max, judy_parent( judy, idx ), off, off / JUDY_key_size );
+    JUDY_inserted( judy, cell );
+    return cell;
 #endif
-    return next;
 }
 
@@ -22,15 +22,23 @@
 //  judy_open:  open a new judy array returning a judy object.
 //  judy_close: close an open judy array, freeing all memory.
 //  judy_clone: clone an open judy array, duplicating the stack.
+//  judy_cursor: open a private, read-only cursor on a judy array.
+//  judy_cursor_close: close a cursor from judy_cursor.
 //  judy_data:  allocate data memory within judy array for external use.
 //  judy_cell:  insert a string into the judy array, return cell pointer.
+//  judy_append: judy_cell, resuming from the current stack; for sorted keys.
 //  judy_strt:  retrieve the cell pointer greater than or equal to given key
+//  judy_seek:  judy_strt, resuming from the current stack (finger search).
 //  judy_slot:  retrieve the cell pointer, or return NULL for a given key.
+//  judy_get:   judy_slot without moving the stack; safe for concurrent readers.
 //  judy_key:   retrieve the string value for the most recent judy query.
 //  judy_end:   retrieve the cell pointer for the last string in the array.
 //  judy_nxt:   retrieve the cell pointer for the next string in the array.
 //  judy_prv:   retrieve the cell pointer for the prev string in the array.
-//  judy_del:   delete the key and cell for the current stack entry.
+//  judy_nxt_key: judy_nxt, updating the key in the caller's buffer.
+//  judy_prv_key: judy_prv, updating the key in the caller's buffer.
+//  judy_del:   delete the key and cell for the current stack entry,
+//              shrinking nodes that become sparse.
 
 
 
@@ -95,6 +103,26 @@ enum JUDY_types {
 #endif
 };
 
+//    a JUDY_radix node whose pointer also has JUDY_flat set is a
+//    flat radix node: one table of 256 slots, in place of the 16
+//    outer slots pointing to inner tables of 16.  radix nodes are
+//    aligned to JUDY_cache_line, which leaves the bit free.
+
+#define JUDY_flat       0x08
+#define JUDY_flat_size  ( 256 * JUDY_slot_size )
+
+//    a JUDY_radix node whose pointer has JUDY_index set instead is
+//    an index node, for up to JUDY_index_slots children: 256 bytes,
+//    one per key byte, holding the position + 1 of its slot, or 0,
+//    then a header slot keeping count of the slots, then the slots.
+//    judy_splitnode makes index nodes, and they become two-level
+//    radix nodes when their slots run out.
+
+#define JUDY_index        0x10
+#define JUDY_index_slots  47
+#define JUDY_index_size   ( 256 + ( JUDY_index_slots + 1 ) * JUDY_slot_size )
+#define JUDY_index_reuse  8     // reuse list of freed index nodes
+
 typedef struct {
     void * seg;               // next used allocator
     unsigned int next;        // next available offset
@@ -106,20 +134,48 @@ typedef struct {
     int slot;                 // slot within object
 } JudyStack;
 
+#ifdef JUDY_INSTRUMENT
+#define JUDY_depths 32        // descents visiting more nodes are counted in the last bucket
+
+/// Structural event counters, kept per judy object when compiled with -DJUDY_INSTRUMENT.
+/// Clones and cursors start from zero and count their own operations. Reset with memset.
+/// Everything that includes judy.h must be compiled with or without it alike.
+typedef struct {
+    unsigned long long lookups;         // judy_slot, judy_get, judy_strt and judy_seek with a key
+    unsigned long long hits;            // lookups that found the key
+    unsigned long long inserts;         // judy_cell and judy_append calls that added a key
+    unsigned long long found;           // judy_cell and judy_append calls for a key already present
+    unsigned long long promotes[8];     // judy_promote, by the size class promoted to; index nodes expanded in [JUDY_radix]
+    unsigned long long splitnodes;      // judy_splitnode
+    unsigned long long splitspans;      // judy_splitspan
+    unsigned long long demotes;         // linear nodes shrunk by judy_del
+    unsigned long long collapses;       // radix nodes merged into a linear node by judy_del
+    unsigned long long flattens;        // radix nodes made flat
+    unsigned long long reuseHits;       // judy_alloc served from a reuse list
+    unsigned long long reuseMisses;     // judy_alloc carved from the current segment
+    unsigned long long segments;        // segments malloc'ed
+    unsigned long long lines;           // cache lines of linear nodes read by lookups and inserts
+    unsigned long long depths[JUDY_depths + 1]; // lookups and inserts by number of nodes visited
+} JudyCounters;
+#endif
+
 typedef struct {
     JudySlot root[1];         // root of judy array
-    void ** reuse[8];         // reuse judy blocks
+    void ** reuse[9];         // reuse judy blocks; flat radix nodes in reuse[JUDY_radix], index nodes in reuse[JUDY_index_reuse]
     JudySeg * seg;            // current judy allocator
     unsigned int level;       // current height of stack
     unsigned int max;         // max height of stack
     unsigned int depth;       // number of Integers in a key, or zero for string keys
+#ifdef JUDY_INSTRUMENT
+    JudyCounters counters;    // structural event counters
+#endif
     JudyStack stack[1];       // current cursor
 } Judy;
 
 #ifdef ASKITIS
-int Words = 0;
-int Inserts = 0;
-int Found = 0;
+// judy_cell calls, and how many added a key or found it present;
+// defined by the benchmark, as MaxMem is
+extern unsigned long long Words, Inserts, Found;
 #  if JUDY_key_size < 8
 #    define JUDY_max    JUDY_16
 #  else
@@ -136,24 +192,48 @@ extern "C" {
     /// open a new judy array returning a judy object.
     Judy * judy_open( unsigned int max, unsigned int depth );
 
-    /// close an open judy array, freeing all memory.
+    /// close an open judy array, freeing all memory. judy may be NULL.
     void judy_close( Judy * judy );
 
     /// clone an open judy array, duplicating the stack.
     Judy * judy_clone( Judy * judy );
 
+    /// open a private cursor on a judy array, for traversal with judy_strt, judy_nxt etc.
+    /// the cursor is invalidated by any change to the array. NULL if out of memory.
+    Judy * judy_cursor( Judy * judy );
+
+    /// close a cursor from judy_cursor.
+    void judy_cursor_close( Judy * cursor );
+
     /// allocate data memory within judy array for external use.
+    /// the memory is zeroed, aligned to JUDY_cache_line, and freed by judy_close.
     void * judy_data( Judy * judy, unsigned int amt );
 
     /// insert a key into the judy array, return cell pointer.
     JudySlot * judy_cell( Judy * judy, const unsigned char * buff, unsigned int max );
 
+    /// insert a key, as judy_cell does, but descending only from the deepest level at which
+    /// the key branches the same way as the key of the current stack entry. Keys inserted in
+    /// ascending order skip most of the descent; any other key costs what judy_cell would.
+    /// The stack must not predate a change made by another cursor or clone.
+    JudySlot * judy_append( Judy * judy, const unsigned char * buff, unsigned int max );
+
     /// retrieve the cell pointer greater than or equal to given key
     JudySlot * judy_strt( Judy * judy, const unsigned char * buff, unsigned int max );
 
+    /// retrieve the cell pointer greater than or equal to given key, as judy_strt does,
+    /// but descending only from the deepest level at which the key branches the same way as
+    /// the key of the current stack entry. Cheap for a sorted run of keys with common prefixes.
+    /// The stack must be from a query (not judy_cell or judy_del) made since the last change.
+    JudySlot * judy_seek( Judy * judy, const unsigned char * buff, unsigned int max );
+
     /// retrieve the cell pointer, or return NULL for a given key.
     JudySlot * judy_slot( Judy * judy, const unsigned char * buff, unsigned int max );
 
+    /// retrieve the cell pointer, or return NULL for a given key, without moving the stack:
+    /// judy_key, judy_nxt etc carry on from the previous query, and the array is only read.
+    JudySlot * judy_get( const Judy * judy, const unsigned char * buff, unsigned int max );
+
     /// retrieve the string value for the most recent judy query.
     unsigned int judy_key( Judy * judy, unsigned char * buff, unsigned int max );
 
@@ -166,7 +246,18 @@ extern "C" {
     /// retrieve the cell pointer for the prev string in the array.
     JudySlot * judy_prv( Judy * judy );
 
-    /// delete the key and cell for the current stack entry.
+    /// judy_nxt, also updating the key in buff, which must hold the key of the current
+    /// entry (from judy_key, or an earlier judy_nxt_key or judy_prv_key on the same buffer).
+    /// Only the bytes from where the new key differs in the trie onward are rewritten.
+    /// max is as for judy_key; the key length is stored in *len.
+    JudySlot * judy_nxt_key( Judy * judy, unsigned char * buff, unsigned int max, unsigned int * len );
+
+    /// judy_prv, also updating the key in buff, as judy_nxt_key does.
+    JudySlot * judy_prv_key( Judy * judy, unsigned char * buff, unsigned int max, unsigned int * len );
+
+    /// delete the key and cell for the current stack entry, and return the cell of the entry before it.
+    /// A linear node under a quarter full is moved to the next smaller size, and a radix node whose keys
+    /// would fill no more than a quarter of the largest linear node is merged back into one.
     JudySlot * judy_del( Judy * judy );
 
 #ifdef __cplusplus
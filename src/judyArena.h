@@ -0,0 +1,269 @@
+#ifndef JUDYARENA_H
+#define JUDYARENA_H
+
+/****************************************************************************//**
+* \file judyArena.h small-block allocator and value storage for the judy templates
+*
+* judyArena carves blocks out of the judy_data() memory of a judy array, and
+* judyArenaAllocator makes it usable by standard containers. judyValueCell
+* stores a JudyValue in a judy cell, or in an arena block that the cell points
+* to if the value does not fit in a JudySlot.
+*
+*    Public domain.
+*
+********************************************************************************/
+
+#include "judy.h"
+#include "assert.h"
+#include <string.h>
+#include <stddef.h>
+#include <new>
+
+/** Allocator backed by judy_data() memory of one judy array.
+ * Released blocks are kept on per-size free lists and recycled; no memory is
+ * returned to the system until the array is closed with judy_close(), which
+ * frees everything allocated from the arena at once.
+ *
+ * Small blocks are carved out of chunks of judy_data() memory in multiples of
+ * 8 bytes; larger ones are rounded up to a power of two and requested from
+ * judy_data() individually.
+ *
+ * The arena itself lives in judy_data() memory, so it never moves and needs
+ * no destructor; create one with judyArena::open().
+ */
+class judyArena {
+    protected:
+        enum {
+            Granule = 8,                   ///< small block sizes are multiples of this
+            SmallClasses = 32,             ///< number of small size classes, Granule to SmallClasses * Granule bytes
+            Classes = SmallClasses + 24,   ///< small classes, then powers of two up to 2^31 bytes
+            ChunkSize = JUDY_seg / 16      ///< amount requested from judy_data() at a time for small blocks
+        };
+        Judy * _judy;
+        unsigned char * _chunk;
+        unsigned int _avail;
+        void * _free[Classes];
+
+        judyArena( Judy * judy ): _judy( judy ), _chunk( 0 ), _avail( 0 ) {
+            for( unsigned int i = 0; i < Classes; i++ ) {
+                _free[i] = 0;
+            }
+        }
+
+        /// the size class for a block of amt bytes; sets size to the size of blocks in that class
+        static unsigned int sizeClass( unsigned int amt, unsigned int & size ) {
+            unsigned int cls = SmallClasses;
+            assert( amt && "zero-length block" );
+            if( amt <= maxSmallBlock ) {
+                size = ( amt + Granule - 1 ) & ~( Granule - 1 );
+                return size / Granule - 1;
+            }
+            for( size = 2 * maxSmallBlock; size < amt && cls < Classes - 1; size <<= 1 ) {
+                cls++;
+            }
+            return cls;
+        }
+    public:
+        /// blocks up to this size share chunks of judy_data() memory
+        static const unsigned int maxSmallBlock = SmallClasses * Granule;
+
+        /// the largest block alloc() hands out
+        static const unsigned int maxBlock = 1U << 31;
+
+        /// create an arena within the judy_data() memory of judy. NULL if out of memory.
+        static judyArena * open( Judy * judy ) {
+            void * mem = judy_data( judy, sizeof( judyArena ) );
+            if( !mem ) {
+                return 0;
+            }
+            return new( mem ) judyArena( judy );
+        }
+
+        /** allocate a zeroed block of at least amt bytes. The block is aligned to
+         * the largest power of two (up to JUDY_cache_line) dividing its size.
+         * \returns NULL if out of memory
+         */
+        void * alloc( unsigned int amt ) {
+            unsigned int size, cls = sizeClass( amt, size );
+            unsigned int align = size & -size;
+            void ** block;
+
+            if( amt > maxBlock ) {
+                return 0;
+            }
+
+            if( ( block = ( void ** ) _free[cls] ) ) {
+                _free[cls] = *block;
+                memset( block, 0, size );
+                return block;
+            }
+
+            if( size > maxSmallBlock ) {
+                return judy_data( _judy, size );
+            }
+
+            if( align > JUDY_cache_line ) {
+                align = JUDY_cache_line;
+            }
+
+            //    carve from the top of the current chunk, as judy_alloc does
+            if( _avail < size ) {
+                if( !( _chunk = ( unsigned char * ) judy_data( _judy, ChunkSize ) ) ) {
+                    _avail = 0;
+                    return 0;
+                }
+                _avail = ChunkSize;
+            }
+            _avail -= size;
+            _avail &= ~( align - 1 );
+            return _chunk + _avail;
+        }
+
+        /// return a block from alloc() to the arena; amt must match the allocation
+        void release( void * block, unsigned int amt ) {
+            unsigned int size, cls = sizeClass( amt, size );
+            *( void ** ) block = _free[cls];
+            _free[cls] = block;
+        }
+};
+
+/** A standard allocator drawing from a judyArena, so that containers stored
+ * in a judy array keep their elements in the array's memory as well.
+ * Memory is recycled within the arena and freed when the array is closed.
+ */
+template< typename T >
+class judyArenaAllocator {
+    public:
+        typedef T value_type;
+        typedef T * pointer;
+        typedef const T * const_pointer;
+        typedef T & reference;
+        typedef const T & const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template< typename U >
+        struct rebind {
+            typedef judyArenaAllocator< U > other;
+        };
+
+        judyArenaAllocator( judyArena * arena ): _arena( arena ) {
+        }
+
+        template< typename U >
+        judyArenaAllocator( const judyArenaAllocator< U > & other ): _arena( other.arena() ) {
+        }
+
+        judyArena * arena() const {
+            return _arena;
+        }
+
+        pointer allocate( size_type n, const void * = 0 ) {
+            if( n > max_size() ) {
+                throw std::bad_alloc();
+            }
+            void * p = n ? _arena->alloc( ( unsigned int )( n * sizeof( T ) ) ) : 0;
+            if( n && !p ) {
+                throw std::bad_alloc();
+            }
+            return ( pointer ) p;
+        }
+
+        void deallocate( pointer p, size_type n ) {
+            if( p ) {
+                _arena->release( p, ( unsigned int )( n * sizeof( T ) ) );
+            }
+        }
+
+        size_type max_size() const {
+            return judyArena::maxBlock / sizeof( T );
+        }
+
+        pointer address( reference x ) const {
+            return &x;
+        }
+
+        const_pointer address( const_reference x ) const {
+            return &x;
+        }
+
+        void construct( pointer p, const T & value ) {
+            new( ( void * ) p ) T( value );
+        }
+
+        void destroy( pointer p ) {
+            p->~T();
+        }
+
+        bool operator==( const judyArenaAllocator & other ) const {
+            return _arena == other._arena;
+        }
+
+        bool operator!=( const judyArenaAllocator & other ) const {
+            return _arena != other._arena;
+        }
+    protected:
+        judyArena * _arena;
+};
+
+/** Storage of a JudyValue in a judy cell.
+ * Values that fit in a JudySlot are stored in the cell itself, and like any
+ * judy cell must be non-zero. Larger values are stored in a judyArena block
+ * that the cell points to; these may be zero.
+ */
+template< typename JudyValue, bool inCell = ( sizeof( JudyValue ) <= sizeof( JudySlot ) ) >
+struct judyValueCell {
+    /// the value held by an occupied cell
+    static JudyValue * get( JudySlot * cell ) {
+        return ( JudyValue * ) cell;
+    }
+
+    /// the value for a cell returned by judy_cell(), allocating storage if necessary
+    static JudyValue * make( JudySlot * cell, Judy *, judyArena *& ) {
+        return ( JudyValue * ) cell;
+    }
+
+    /// release the storage of a cell; nothing to do for an empty one
+    static void release( JudySlot *, judyArena * ) {
+    }
+
+    /// true if value can be stored; cells holding values must be non-zero
+    static bool storable( const JudyValue & value ) {
+        const unsigned char * byte = ( const unsigned char * ) &value;
+        for( unsigned int i = 0; i < sizeof( JudyValue ); i++ ) {
+            if( byte[i] ) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template< typename JudyValue >
+struct judyValueCell< JudyValue, false > {
+    static JudyValue * get( JudySlot * cell ) {
+        return ( JudyValue * ) *cell;
+    }
+
+    static JudyValue * make( JudySlot * cell, Judy * judy, judyArena *& arena ) {
+        if( !*cell ) {
+            if( !arena && !( arena = judyArena::open( judy ) ) ) {
+                return 0;
+            }
+            *cell = ( JudySlot ) arena->alloc( sizeof( JudyValue ) );
+        }
+        return ( JudyValue * ) *cell;
+    }
+
+    static void release( JudySlot * cell, judyArena * arena ) {
+        if( arena && *cell ) {
+            arena->release( ( void * ) *cell, sizeof( JudyValue ) );
+        }
+    }
+
+    static bool storable( const JudyValue & ) {
+        return true;
+    }
+};
+
+#endif //JUDYARENA_H
@@ -0,0 +1,232 @@
+#ifndef JUDYCURSOR_H
+#define JUDYCURSOR_H
+
+/****************************************************************************//**
+* \file judyCursor.h position within a judy array, independent of the array's own
+*
+* judyCursor is the common part of the iterators of the judy templates. It owns
+* a private cursor from judy_cursor(), so any number of iterators can traverse
+* an array at once without disturbing each other or the array's most recent
+* query. The cursor is opened on first use, so end iterators cost nothing.
+* Once a key has been asked for, the cursor keeps it up to date as it moves,
+* with judy_nxt_key() and judy_prv_key().
+*
+*    Public domain.
+*
+********************************************************************************/
+
+#include "judy.h"
+#include "assert.h"
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/// selects the reference type returned by an iterator's value()
+template< bool isConst, typename T >
+struct judyReference {
+    typedef T & type;
+};
+
+template< typename T >
+struct judyReference< true, T > {
+    typedef const T & type;
+};
+
+/** A position in a judy array, with a cursor of its own.
+ * Like the iterators of std::map, but unlike them, a judyCursor is
+ * invalidated by any insertion into or deletion from the array.
+ * A judyCursor on no array, as a moved-from template has, is always at the end.
+ */
+class judyCursor {
+    protected:
+        Judy * _judy;        ///< the array
+        Judy * _cursor;      ///< private cursor on _judy; NULL until first used
+        JudySlot * _slot;    ///< the current cell, NULL at the end
+        mutable std::vector< unsigned char > _key;    ///< the current key, if _keyValid
+        mutable unsigned int _keyLen;
+        mutable bool _keyValid;
+
+        /// open the cursor if necessary; throws std::bad_alloc if out of memory
+        Judy * cursor() {
+            if( !_cursor && !( _cursor = judy_cursor( _judy ) ) ) {
+                throw std::bad_alloc();
+            }
+            return _cursor;
+        }
+
+        /// step past cells holding 0: judy_strt and judy_seek stop at one when
+        /// the key matches the bytes of an unused slot, but it is not an entry
+        void skipEmpty() {
+            while( _slot && !*_slot ) {
+                _slot = judy_nxt( _cursor );
+                _keyValid = false;
+            }
+        }
+
+        /// as skipEmpty(), moving backwards
+        void skipEmptyBack() {
+            while( _slot && !*_slot ) {
+                _slot = judy_prv( _cursor );
+                _keyValid = false;
+            }
+        }
+    public:
+        judyCursor( Judy * judy = 0 ): _judy( judy ), _cursor( 0 ), _slot( 0 ), _keyLen( 0 ), _keyValid( false ) {
+        }
+
+        judyCursor( const judyCursor & other ): _judy( other._judy ), _cursor( 0 ), _slot( other._slot ), _key( other._key ),
+            _keyLen( other._keyLen ), _keyValid( other._keyValid ) {
+            if( other._cursor && !( _cursor = judy_cursor( other._cursor ) ) ) {
+                throw std::bad_alloc();
+            }
+        }
+
+#ifdef HAVE_STD_ENABLEIF
+        judyCursor( judyCursor && other ) noexcept: _judy( other._judy ), _cursor( other._cursor ), _slot( other._slot ),
+            _key( std::move( other._key ) ), _keyLen( other._keyLen ), _keyValid( other._keyValid ) {
+            other._cursor = 0;
+            other._keyValid = false;
+        }
+#endif
+
+        judyCursor & operator=( const judyCursor & other ) {
+            if( this != &other ) {
+                judyCursor tmp( other );
+                swap( tmp );
+            }
+            return *this;
+        }
+
+        ~judyCursor() {
+            judy_cursor_close( _cursor );
+        }
+
+        void swap( judyCursor & other ) {
+            Judy * judy = _judy, * cursor = _cursor;
+            JudySlot * slot = _slot;
+            unsigned int keyLen = _keyLen;
+            bool keyValid = _keyValid;
+            _judy = other._judy;
+            _cursor = other._cursor;
+            _slot = other._slot;
+            _keyLen = other._keyLen;
+            _keyValid = other._keyValid;
+            other._judy = judy;
+            other._cursor = cursor;
+            other._slot = slot;
+            other._keyLen = keyLen;
+            other._keyValid = keyValid;
+            _key.swap( other._key );
+        }
+
+        /// the current cell, or NULL at the end
+        JudySlot * slot() const {
+            return _slot;
+        }
+
+        /// move to the first key
+        void first() {
+            _keyValid = false;
+            _slot = _judy ? judy_strt( cursor(), ( const unsigned char * ) "", 0 ) : 0;
+            skipEmpty();
+        }
+
+        /// move to the last key
+        void last() {
+            _keyValid = false;
+            _slot = _judy ? judy_end( cursor() ) : 0;
+            skipEmptyBack();
+        }
+
+        /// move to the first key greater than or equal to key, resuming the
+        /// search from the current position if there is one (see judy_seek)
+        void seek( const unsigned char * key, unsigned int len ) {
+            _keyValid = false;
+            if( _cursor ) {
+                _slot = judy_seek( _cursor, key, len );
+            } else {
+                _slot = _judy ? judy_strt( cursor(), key, len ) : 0;
+            }
+            skipEmpty();
+        }
+
+        /// move to the next key; must not be at the end
+        void next() {
+            assert( _slot && "incrementing past the end" );
+            if( _keyValid ) {
+                _slot = judy_nxt_key( _cursor, &_key[0], ( unsigned int ) _key.size(), &_keyLen );
+                _keyValid = ( _slot != 0 );
+            } else {
+                _slot = judy_nxt( _cursor );
+            }
+            skipEmpty();
+        }
+
+        /// move to the previous key; from the end, moves to the last key
+        void prev() {
+            if( !_slot ) {
+                last();
+            } else if( _keyValid ) {
+                _slot = judy_prv_key( _cursor, &_key[0], ( unsigned int ) _key.size(), &_keyLen );
+                _keyValid = ( _slot != 0 );
+            } else {
+                _slot = judy_prv( _cursor );
+            }
+            skipEmptyBack();
+        }
+
+        /** the current key, and its length in len; must not be at the end.
+         * String keys are NUL-terminated. Valid until the cursor moves.
+         */
+        const unsigned char * keyBytes( unsigned int & len ) const {
+            assert( _slot && "no key at the end" );
+            if( !_keyValid ) {
+                _key.resize( keyBufferSize() );
+                _keyLen = judy_key( _cursor, &_key[0], ( unsigned int ) _key.size() );
+                _keyValid = true;
+            }
+            len = _keyLen;
+            return &_key[0];
+        }
+
+        /// copy the current key to buff, as judy_key does; must not be at the end
+        unsigned int key( unsigned char * buff, unsigned int max ) const {
+            assert( _slot && "no key at the end" );
+            return judy_key( _cursor, buff, max );
+        }
+
+        /// the size of a buffer that can hold any key of the array, with its terminator
+        unsigned int keyBufferSize() const {
+            return _judy->max;
+        }
+
+        bool operator==( const judyCursor & other ) const {
+            return _slot == other._slot;
+        }
+
+        bool operator!=( const judyCursor & other ) const {
+            return _slot != other._slot;
+        }
+};
+
+/** A pair of iterators, so that a range-based for loop can visit a judy array
+ * without going through the array's own begin() and end(), which return pairs.
+ */
+template< typename Iterator >
+class judyRange {
+    protected:
+        Iterator _begin, _end;
+    public:
+        judyRange( const Iterator & b, const Iterator & e ): _begin( b ), _end( e ) {
+        }
+
+        Iterator begin() const {
+            return _begin;
+        }
+
+        Iterator end() const {
+            return _end;
+        }
+};
+
+#endif //JUDYCURSOR_H
@@ -5,16 +5,21 @@
 * \file judyL2Array.h C++ wrapper for judyL2 array implementation
 *
 * A judyL2 array maps JudyKey's to multiple JudyValue's, similar to
-* std::multimap. Internally, this is a judyL array of std::vector< JudyValue >.
+* std::multimap. Internally, this is a judyL array of judyValueList's.
 *
 *    Author: Mark Pictor. Public domain.
 *
 ********************************************************************************/
 
 #include "judy.h"
+#include "judyArena.h"
+#include "judyCursor.h"
+#include "judyValueList.h"
 #include "assert.h"
-#include <iterator>
 #include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
 
 template< typename JudyKey, typename vec >
 struct judyl2KVpair {
@@ -22,96 +27,271 @@ struct judyl2KVpair {
     vec value;
 };
 
-//TODO: use vectors only when >( sizeof(vector)/sizeof(value) ) values, and store data/vector within judy.
-
 /** A judyL2 array maps JudyKey's to multiple JudyValue's, similar to std::multimap.
- * Internally, this is a judyL array of std::vector< JudyValue >.
+ * Internally, this is a judyL array of judyValueList's. The first inlineValues
+ * values for a key are stored in a small block within the array's memory; a
+ * std::vector is only allocated for keys with more values than that.
+ * The values for a key are returned as a cvector, a read-only view of them.
+ *
  * The first template parameter must be the same size as a void*
  *  \param JudyKey the type of the key, i.e. uint64_t, etc
  *  \param JudyValue the type of the value, i.e. int, pointer-to-object, etc. With judyL2Array, the size of this value can vary.
+ *  \param inlineValues the number of values per key stored without allocating a vector
  */
-template< typename JudyKey, typename JudyValue >
+template< typename JudyKey, typename JudyValue, unsigned int inlineValues = 2 >
 class judyL2Array {
     public:
         typedef std::vector< JudyValue > vector;
-        typedef const vector cvector;
-        typedef judyl2KVpair< JudyKey, vector * > pair;
+        typedef judyValueSpan< JudyValue > span;
+        typedef const span cvector;
+        typedef judyl2KVpair< JudyKey, span * > pair;
         typedef judyl2KVpair< JudyKey, cvector * > cpair;
     protected:
+        typedef judyValueList< JudyValue, inlineValues > list;
         Judy * _judyarray;
+        judyArena * _arena;
         unsigned int _maxLevels, _depth;
-        vector ** _lastSlot;
+        JudySlot * _lastSlot;
         JudyKey _buff[1];
         bool _success;
         cpair kv;
+        span _kvSpan, _findSpan;
+
+        /// the list for _lastSlot, which must be from judy_cell or judy_append
+        list * lastList() {
+            return list::make( _lastSlot, judy(), _arena );
+        }
+
+        /// run the destructors of all values, unless that is a no-op
+        void destroyValues() {
+            JudySlot * cell;
+            JudyKey key = 0;
+            if( list::trivial || !_judyarray ) {
+                return;
+            }
+            for( cell = judy_strt( _judyarray, ( const unsigned char * ) &key, 0 ); cell; cell = judy_nxt( _judyarray ) ) {
+                list::destroy( cell );
+            }
+        }
+
+        /// the judy array, opened again if this array has been moved from
+        Judy * judy() {
+            if( !_judyarray ) {
+                _judyarray = judy_open( _maxLevels, _depth );
+            }
+            return _judyarray;
+        }
+
+        /// insert every key and its values from other; other is traversed with a cursor of its own
+        void copyFrom( const judyL2Array< JudyKey, JudyValue, inlineValues > & other ) {
+            JudySlot * slot;
+            JudyKey key = 0;
+            Judy * cursor = other._judyarray ? judy_cursor( other._judyarray ) : 0;
+            _success = ( cursor != 0 || !other._judyarray );
+            for( slot = cursor ? judy_strt( cursor, ( const unsigned char * ) &key, 0 ) : 0; slot && _success; slot = judy_nxt( cursor ) ) {
+                span values = list::get( slot )->values();
+                list * l = 0;
+                judy_key( cursor, ( unsigned char * ) &key, _depth * JUDY_key_size );
+                _lastSlot = judy_append( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+                if( _lastSlot && ( l = lastList() ) ) {
+                    l->append( values.begin(), values.end(), _arena );
+                } else {
+                    _success = false;
+                }
+            }
+            judy_cursor_close( cursor );
+            _lastSlot = 0;
+        }
+
+        /// the values for _lastSlot, or NULL; sets _success
+        cvector * lastValues() {
+            _success = ( _lastSlot && *_lastSlot );
+            if( !_success ) {
+                return 0;
+            }
+            _findSpan = list::get( _lastSlot )->values();
+            return &_findSpan;
+        }
     public:
-        judyL2Array(): _maxLevels( sizeof( JudyKey ) ), _depth( 1 ), _lastSlot( 0 ), _success( true ) {
+        /** A bidirectional iterator over the key-value pairs, in key order.
+         * Each iterator has a cursor of its own, so several can be used at once,
+         * and with <algorithm>; the most recent query of the array is unaffected.
+         * iterator and const_iterator are the same, since values are read-only.
+         * The key is only built when it is asked for, or the iterator is
+         * dereferenced. Iterators are invalidated by any insertion or deletion.
+         */
+        class iter: public judyCursor {
+            protected:
+                mutable cpair _pair;
+                mutable span _span;
+            public:
+                typedef std::bidirectional_iterator_tag iterator_category;
+                typedef cpair value_type;
+                typedef ptrdiff_t difference_type;
+                typedef const cpair * pointer;
+                typedef const cpair & reference;
+
+                explicit iter( Judy * judy = 0 ): judyCursor( judy ) {
+                }
+
+                JudyKey key() const {
+                    JudyKey k = 0;
+                    judyCursor::key( ( unsigned char * ) &k, JUDY_key_size );
+                    return k;
+                }
+
+                /// the values for the key
+                cvector value() const {
+                    return list::get( _slot )->values();
+                }
+
+                reference operator*() const {
+                    _pair.key = key();
+                    _span = value();
+                    _pair.value = &_span;
+                    return _pair;
+                }
+
+                pointer operator->() const {
+                    return &**this;
+                }
+
+                iter & operator++() {
+                    next();
+                    return *this;
+                }
+
+                iter operator++( int ) {
+                    iter tmp( *this );
+                    next();
+                    return tmp;
+                }
+
+                iter & operator--() {
+                    prev();
+                    return *this;
+                }
+
+                iter operator--( int ) {
+                    iter tmp( *this );
+                    prev();
+                    return tmp;
+                }
+
+                /** move to the first key not less than key, or to the end.
+                 * Only the part of the trie below where key branches off from
+                 * the current key is searched, so seeking forward through
+                 * nearby keys in order is much cheaper than lower_bound().
+                 */
+                iter & seek( JudyKey key ) {
+                    judyCursor::seek( ( const unsigned char * ) &key, JUDY_key_size );
+                    return *this;
+                }
+        };
+        typedef iter iterator;
+        typedef iter const_iterator;
+
+        judyL2Array(): _arena( 0 ), _maxLevels( sizeof( JudyKey ) ), _depth( 1 ), _lastSlot( 0 ), _success( true ) {
             assert( sizeof( JudyKey ) == JUDY_key_size && "JudyKey *must* be the same size as a pointer!" );
             _judyarray = judy_open( _maxLevels, _depth );
             _buff[0] = 0;
         }
 
-        explicit judyL2Array( const judyL2Array< JudyKey, JudyValue > & other ): _maxLevels( other._maxLevels ),
-            _depth( other._depth ), _success( other._success ) {
-            _judyarray = judy_clone( other._judyarray );
-            _buff[0] = other._buff[0];
-            find( *_buff ); //set _lastSlot
+        /// deep copy: the copy has its own nodes and values, and no most recent query
+        explicit judyL2Array( const judyL2Array< JudyKey, JudyValue, inlineValues > & other ): _arena( 0 ), _maxLevels( other._maxLevels ),
+            _depth( other._depth ), _lastSlot( 0 ), _success( true ) {
+            _judyarray = judy_open( _maxLevels, _depth );
+            _buff[0] = 0;
+            copyFrom( other );
+        }
+
+#ifdef HAVE_STD_ENABLEIF
+        /// take over the contents of other. other is left empty; its judy array is opened again when it is next used
+        judyL2Array( judyL2Array< JudyKey, JudyValue, inlineValues > && other ) noexcept: _judyarray( 0 ), _arena( 0 ), _maxLevels( other._maxLevels ),
+            _depth( other._depth ), _lastSlot( 0 ), _success( true ) {
+            _buff[0] = 0;
+            swap( other );
+        }
+
+        judyL2Array & operator=( judyL2Array< JudyKey, JudyValue, inlineValues > && other ) noexcept {
+            judyL2Array< JudyKey, JudyValue, inlineValues > tmp( std::move( other ) );
+            swap( tmp );
+            return *this;
+        }
+#endif
+
+        /// replace the contents with a deep copy of other
+        judyL2Array & operator=( const judyL2Array< JudyKey, JudyValue, inlineValues > & other ) {
+            if( this != &other ) {
+                judyL2Array< JudyKey, JudyValue, inlineValues > tmp( other );
+                swap( tmp );
+            }
+            return *this;
         }
 
-        /// calls clear, so should be safe to call at any point
         ~judyL2Array() {
-            clear();
+            destroyValues();
             judy_close( _judyarray );
         }
 
-        /// delete all vectors and empty the array
+        /// exchange the contents of two arrays; no keys or values are copied
+        void swap( judyL2Array< JudyKey, JudyValue, inlineValues > & other ) {
+            std::swap( _judyarray, other._judyarray );
+            std::swap( _arena, other._arena );
+            std::swap( _maxLevels, other._maxLevels );
+            std::swap( _depth, other._depth );
+            std::swap( _lastSlot, other._lastSlot );
+            std::swap( _buff[0], other._buff[0] );
+            std::swap( _success, other._success );
+        }
+
+        /** delete all values and empty the array.
+         * All memory used by the array, including any vectors, is released at once.
+         */
         void clear() {
-            JudyKey key = 0;
-            while( 0 != ( _lastSlot = ( vector ** ) judy_strt( _judyarray, ( const unsigned char * ) &key, 0 ) ) ) {
-                //( * _lastSlot )->~vector(); //TODO: placement new
-                delete( * _lastSlot );
-                judy_del( _judyarray );
-            }
+            destroyValues();
+            judy_close( _judyarray );
+            _judyarray = judy_open( _maxLevels, _depth );
+            _arena = 0;
+            _lastSlot = 0;
         }
 
-        vector * getLastValue() {
+        cvector * getLastValue() {
             assert( _lastSlot );
-            return &_lastSlot;
+            _findSpan = list::get( _lastSlot )->values();
+            return &_findSpan;
         }
 
-        void setLastValue( vector * value ) {
+        /// replace the values for the most recent key
+        void setLastValue( const vector & values ) {
             assert( _lastSlot );
-            &_lastSlot = value;
+            list::get( _lastSlot )->clear();
+            list::get( _lastSlot )->append( values.begin(), values.end(), _arena );
         }
 
         bool success() {
             return _success;
         }
 
+#ifdef JUDY_INSTRUMENT
+        /// structural event counters of the array; iterators count in their own cursors
+        const JudyCounters & counters() const {
+            static const JudyCounters none = JudyCounters();
+            return _judyarray ? _judyarray->counters : none;
+        }
+#endif
+
         /** TODO
          * test for std::vector::shrink_to_fit (C++11), use it once the array is as full as it will be
          * void freeUnused() {...}
          */
 
-        //TODO
-        // allocate data memory within judy array for external use.
-        // void *judy_data (Judy *judy, unsigned int amt);
-
-        /// insert value into the vector for key.
+        /// insert value into the values for key.
         bool insert( JudyKey key, JudyValue value ) {
-            _lastSlot = ( vector ** ) judy_cell( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
-            if( _lastSlot ) {
-                if( !( * _lastSlot ) ) {
-                    * _lastSlot = new vector;
-                    /* TODO store vectors inside judy with placement new
-                    * vector * n = judy_data( _judyarray, sizeof( std::vector < JudyValue > ) );
-                    * new(n) vector;
-                    * *_lastSlot = n;
-                    * NOTE - memory alloc'd via judy_data will not be freed until the array is freed (judy_close)
-                    * also use placement new in the other insert function, below
-                    */
-                }
-                ( * _lastSlot )->push_back( value );
+            list * l = 0;
+            _lastSlot = judy_cell( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            if( _lastSlot && ( l = lastList() ) ) {
+                l->push_back( value, _arena );
                 _success = true;
             } else {
                 _success = false;
@@ -119,22 +299,15 @@ class judyL2Array {
             return _success;
         }
 
-        /** for a given key, append to or overwrite the vector
-         * this never simply re-uses the pointer to the given vector because
-         * that would mean that two keys could have the same value (pointer).
-         */
+        /// for a given key, append to or overwrite the values
         bool insert( JudyKey key, const vector & values, bool overwrite = false ) {
-            _lastSlot = ( vector ** ) judy_cell( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
-            if( _lastSlot ) {
-                if( !( * _lastSlot ) ) {
-                    * _lastSlot = new vector;
-                    /* TODO store vectors inside judy with placement new
-                     * (see other insert(), above)
-                     */
-                } else if( overwrite ) {
-                    ( * _lastSlot )->clear();
+            list * l = 0;
+            _lastSlot = judy_cell( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            if( _lastSlot && ( l = lastList() ) ) {
+                if( overwrite ) {
+                    l->clear();
                 }
-                std::copy( values.begin(), values.end(), std::back_inserter< vector >( ( ** _lastSlot ) ) );
+                l->append( values.begin(), values.end(), _arena );
                 _success = true;
             } else {
                 _success = false;
@@ -145,16 +318,25 @@ class judyL2Array {
         /// retrieve the cell pointer greater than or equal to given key
         /// NOTE what about an atOrBefore function?
         const cpair atOrAfter( JudyKey key ) {
-            _lastSlot = ( vector ** ) judy_strt( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            // judy_strt can stop at an empty cell whose key bytes match
+            while( _lastSlot && !*_lastSlot ) {
+                _lastSlot = judy_nxt( judy() );
+            }
             return mostRecentPair();
         }
 
-        /// retrieve the cell pointer, or return NULL for a given key.
+        /** retrieve the values for a given key, or return NULL.
+         * The view is valid until the next call to find() or getLastValue().
+         * The lookup leaves the array's position alone: next(), previous() and
+         * mostRecentPair() carry on from the last atOrAfter(), begin() etc.
+         */
         cvector * find( JudyKey key ) {
-            _lastSlot = ( vector ** ) judy_slot( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            _lastSlot = judy_get( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
             if( ( _lastSlot ) && ( * _lastSlot ) ) {
                 _success = true;
-                return * _lastSlot;
+                _findSpan = list::get( _lastSlot )->values();
+                return &_findSpan;
             } else {
                 _success = false;
                 return 0;
@@ -163,12 +345,13 @@ class judyL2Array {
 
         /// retrieve the key-value pair for the most recent judy query.
         inline const cpair & mostRecentPair() {
-            judy_key( _judyarray, ( unsigned char * ) _buff, _depth * JUDY_key_size );
-            if( _lastSlot ) {
-                kv.value = *_lastSlot;
+            judy_key( judy(), ( unsigned char * ) _buff, _depth * JUDY_key_size );
+            if( ( _lastSlot ) && ( * _lastSlot ) ) {
+                _kvSpan = list::get( _lastSlot )->values();
+                kv.value = &_kvSpan;
                 _success = true;
             } else {
-                kv.value = ( JudyValue ) 0;
+                kv.value = 0;
                 _success = false;
             }
             kv.key = _buff[0];
@@ -178,47 +361,115 @@ class judyL2Array {
         /// retrieve the first key-value pair in the array
         const cpair & begin() {
             JudyKey key = 0;
-            _lastSlot = ( vector ** ) judy_strt( _judyarray, ( const unsigned char * ) &key, 0 );
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) &key, 0 );
             return mostRecentPair();
         }
 
         /// retrieve the last key-value pair in the array
         const cpair & end() {
-            _lastSlot = ( vector ** ) judy_end( _judyarray );
+            _lastSlot = judy_end( judy() );
             return mostRecentPair();
         }
 
         /// retrieve the key-value pair for the next string in the array.
         const cpair & next() {
-            _lastSlot = ( vector ** ) judy_nxt( _judyarray );
+            _lastSlot = judy_nxt( judy() );
             return mostRecentPair();
         }
 
         /// retrieve the key-value pair for the prev string in the array.
         const cpair & previous() {
-            _lastSlot = ( vector ** ) judy_prv( _judyarray );
+            _lastSlot = judy_prv( judy() );
             return mostRecentPair();
         }
 
+        /** move to the first key and return its values, or NULL if the array is
+         * empty. Unlike begin(), the key is not built; use with nextValue() to
+         * visit the values alone. The view is valid until the next call.
+         */
+        cvector * firstValue() {
+            JudyKey key = 0;
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) &key, 0 );
+            return lastValues();
+        }
+
+        /// move to the next key and return its values, or NULL at the end. The key is not built.
+        cvector * nextValue() {
+            _lastSlot = judy_nxt( judy() );
+            return lastValues();
+        }
+
+        /** call f with the values for each key, in key order, without building
+         * any keys. f takes a cvector &, a read-only view of the values.
+         * A cursor of its own is used, so the most recent query is unaffected.
+         */
+        template< typename Function >
+        void forEachValue( Function f ) {
+            judyCursor c( judy() );
+            for( c.first(); c.slot(); c.next() ) {
+                cvector values = list::get( c.slot() )->values();
+                f( values );
+            }
+        }
+
         /** delete a key-value pair. If the array is not empty,
          * getLastValue() will return the entry before the one that was deleted
          * \sa isEmpty()
          */
         bool removeEntry( JudyKey key ) {
-            if( 0 != ( _lastSlot = ( vector ** ) judy_slot( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) ) {
-                // _lastSlot->~vector(); //for use with placement new
-                delete _lastSlot;
-                _lastSlot = ( vector ** ) judy_del( _judyarray );
+            if( 0 != ( _lastSlot = judy_slot( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) && 0 != *_lastSlot ) {
+                list::release( _lastSlot, _arena );
+                _lastSlot = judy_del( judy() );
                 return true;
             } else {
                 return false;
             }
         }
 
+        /// iterator at the first key
+        const_iterator cbegin() const {
+            const_iterator it( _judyarray );
+            it.first();
+            return it;
+        }
+
+        /// iterator past the last key
+        const_iterator cend() const {
+            return const_iterator( _judyarray );
+        }
+
+        /// the key-value pairs in key order, for a range-based for loop
+        judyRange< iterator > items() {
+            iterator it( judy() );
+            it.first();
+            return judyRange< iterator >( it, iterator( judy() ) );
+        }
+
+        /// iterator at the first key not less than key, or cend()
+        iterator lower_bound( JudyKey key ) {
+            iterator it( judy() );
+            it.seek( key );
+            return it;
+        }
+
+        /// iterator at the first key greater than key, or cend()
+        iterator upper_bound( JudyKey key ) {
+            iterator it = lower_bound( key );
+            if( it.slot() && it.key() == key ) {
+                ++it;
+            }
+            return it;
+        }
+
         /// true if the array is empty
         bool isEmpty() {
             JudyKey key = 0;
-            return ( ( judy_strt( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) ? false : true );
+            return ( ( judy_strt( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) ? false : true );
         }
 };
+
+template< typename JudyKey, typename JudyValue, unsigned int inlineValues >
+void swap( judyL2Array< JudyKey, JudyValue, inlineValues > & a, judyL2Array< JudyKey, JudyValue, inlineValues > & b ) {
+    a.swap( b );
+}
 #endif //JUDYL2ARRAY_H
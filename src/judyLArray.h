@@ -5,14 +5,21 @@
 * \file judyLArray.h C++ wrapper for judyL array implementation
 *
 * A judyL array maps JudyKey's to corresponding memory cells, each containing
-* a JudyValue. Each cell must be set to a non-zero value by the caller.
+* a JudyValue. JudyValue's that are no larger than a pointer are stored in the
+* cell and must be non-zero; larger ones are stored in memory belonging to the
+* array.
 *
 *    Author: Mark Pictor. Public domain.
 *
 ********************************************************************************/
 
 #include "judy.h"
+#include "judyArena.h"
+#include "judyCursor.h"
 #include "assert.h"
+#include <algorithm>
+#include <utility>
+#include <iterator>
 
 #ifdef HAVE_STD_ENABLEIF
 #include <type_traits>
@@ -25,9 +32,12 @@ struct judylKVpair {
 };
 
 /** A judyL array maps JudyKey's to corresponding memory cells, each containing
- * a JudyValue. Each cell must be set to a non-zero value by the caller.
+ * a JudyValue.
  *
- * Both template parameters must be the same size as a void*
+ * JudyKey must be the same size as a void*. JudyValue may be any trivially
+ * copyable type. If it is no larger than a void* it is stored in the cell
+ * itself and must be non-zero; otherwise it is stored in a block allocated
+ * from the array's judy_data() memory, and the cell points to the block.
  *  \param JudyKey the type of the key, i.e. uint64_t, pointer-to-object, etc
  *  \param JudyValue the type of the value
  */
@@ -36,96 +46,282 @@ class judyLArray {
     public:
         typedef judylKVpair< JudyKey, JudyValue > pair;
     protected:
+        typedef judyValueCell< JudyValue > cell;
+#ifdef HAVE_STD_ENABLEIF
+        static_assert( std::is_trivially_copyable< JudyValue >::value, "JudyValue must be trivially copyable" );
+#endif
         Judy * _judyarray;
+        judyArena * _arena;
         unsigned int _maxLevels, _depth;
-        JudyValue * _lastSlot;
+        JudySlot * _lastSlot;
         JudyKey _buff[1];
         bool _success;
         pair _kv;
+
+        /// the judy array, opened again if this array has been moved from
+        Judy * judy() {
+            if( !_judyarray ) {
+                _judyarray = judy_open( _maxLevels, _depth );
+            }
+            return _judyarray;
+        }
+
+        /// insert every key-value pair of other; other is traversed with a cursor of its own
+        void copyFrom( const judyLArray< JudyKey, JudyValue > & other ) {
+            JudySlot * slot;
+            JudyKey key = 0;
+            Judy * cursor = other._judyarray ? judy_cursor( other._judyarray ) : 0;
+            _success = ( cursor != 0 || !other._judyarray );
+            for( slot = cursor ? judy_strt( cursor, ( const unsigned char * ) &key, 0 ) : 0; slot && _success; slot = judy_nxt( cursor ) ) {
+                judy_key( cursor, ( unsigned char * ) &key, _depth * JUDY_key_size );
+                push_back( key, *cell::get( slot ) );
+            }
+            judy_cursor_close( cursor );
+            _lastSlot = 0;
+        }
+
+        /// store value in _lastSlot, which is from judy_cell or judy_append; sets _success
+        bool storeLast( JudyValue value ) {
+            JudyValue * v = 0;
+            if( _lastSlot && ( v = cell::make( _lastSlot, judy(), _arena ) ) ) {
+                *v = value;
+                _success = true;
+            } else {
+                _success = false;
+            }
+            return _success;
+        }
+
+        /// the value for _lastSlot, or NULL; sets _success
+        JudyValue * lastValuePtr() {
+            _success = ( _lastSlot != 0 );
+            return _lastSlot ? cell::get( _lastSlot ) : 0;
+        }
     public:
-        judyLArray(): _maxLevels( sizeof( JudyKey ) ), _depth( 1 ), _lastSlot( 0 ), _success( true ) {
+        /** A bidirectional iterator over the key-value pairs, in key order.
+         * Each iterator has a cursor of its own, so several can be used at once,
+         * and with <algorithm>; the most recent query of the array is unaffected.
+         * The key is only built when it is asked for, or the iterator is
+         * dereferenced. Iterators are invalidated by any insertion or deletion.
+         */
+        template< bool isConst >
+        class iter: public judyCursor {
+            protected:
+                mutable pair _pair;
+            public:
+                typedef std::bidirectional_iterator_tag iterator_category;
+                typedef pair value_type;
+                typedef ptrdiff_t difference_type;
+                typedef const pair * pointer;
+                typedef const pair & reference;
+
+                explicit iter( Judy * judy = 0 ): judyCursor( judy ) {
+                }
+
+                /// an iterator converts to a const_iterator
+                iter( const iter< false > & other ): judyCursor( other ) {
+                }
+
+                JudyKey key() const {
+                    JudyKey k = 0;
+                    judyCursor::key( ( unsigned char * ) &k, JUDY_key_size );
+                    return k;
+                }
+
+                typename judyReference< isConst, JudyValue >::type value() const {
+                    return *cell::get( _slot );
+                }
+
+                reference operator*() const {
+                    _pair.key = key();
+                    _pair.value = value();
+                    return _pair;
+                }
+
+                pointer operator->() const {
+                    return &**this;
+                }
+
+                iter & operator++() {
+                    next();
+                    return *this;
+                }
+
+                iter operator++( int ) {
+                    iter tmp( *this );
+                    next();
+                    return tmp;
+                }
+
+                iter & operator--() {
+                    prev();
+                    return *this;
+                }
+
+                iter operator--( int ) {
+                    iter tmp( *this );
+                    prev();
+                    return tmp;
+                }
+
+                /** move to the first key not less than key, or to the end.
+                 * Only the part of the trie below where key branches off from
+                 * the current key is searched, so seeking forward through
+                 * nearby keys in order is much cheaper than lower_bound().
+                 */
+                iter & seek( JudyKey key ) {
+                    judyCursor::seek( ( const unsigned char * ) &key, JUDY_key_size );
+                    return *this;
+                }
+        };
+        typedef iter< false > iterator;
+        typedef iter< true > const_iterator;
+
+        judyLArray(): _arena( 0 ), _maxLevels( sizeof( JudyKey ) ), _depth( 1 ), _lastSlot( 0 ), _success( true ) {
             assert( sizeof( JudyKey ) == JUDY_key_size && "JudyKey *must* be the same size as a pointer!" );
-            assert( sizeof( JudyValue ) == JUDY_key_size && "JudyValue *must* be the same size as a pointer!" );
             _judyarray = judy_open( _maxLevels, _depth );
             _buff[0] = 0;
         }
 
-        explicit judyLArray( const judyLArray< JudyKey, JudyValue > & other ): _maxLevels( other._maxLevels ),
-            _depth( other._depth ), _success( other._success ) {
-            _judyarray = judy_clone( other._judyarray );
-            _buff[0] = other._buff[0];
-            find( *_buff ); //set _lastSlot
+        /// deep copy: the copy has its own nodes and values, and no most recent query
+        explicit judyLArray( const judyLArray< JudyKey, JudyValue > & other ): _arena( 0 ), _maxLevels( other._maxLevels ),
+            _depth( other._depth ), _lastSlot( 0 ), _success( true ) {
+            _judyarray = judy_open( _maxLevels, _depth );
+            _buff[0] = 0;
+            copyFrom( other );
+        }
+
+#ifdef HAVE_STD_ENABLEIF
+        /// take over the contents of other. other is left empty; its judy array is opened again when it is next used
+        judyLArray( judyLArray< JudyKey, JudyValue > && other ) noexcept: _judyarray( 0 ), _arena( 0 ), _maxLevels( other._maxLevels ),
+            _depth( other._depth ), _lastSlot( 0 ), _success( true ) {
+            _buff[0] = 0;
+            swap( other );
+        }
+
+        judyLArray & operator=( judyLArray< JudyKey, JudyValue > && other ) noexcept {
+            judyLArray< JudyKey, JudyValue > tmp( std::move( other ) );
+            swap( tmp );
+            return *this;
+        }
+#endif
+
+        /// replace the contents with a deep copy of other
+        judyLArray & operator=( const judyLArray< JudyKey, JudyValue > & other ) {
+            if( this != &other ) {
+                judyLArray< JudyKey, JudyValue > tmp( other );
+                swap( tmp );
+            }
+            return *this;
         }
 
         ~judyLArray() {
             judy_close( _judyarray );
         }
 
+        /// exchange the contents of two arrays; no keys or values are copied
+        void swap( judyLArray< JudyKey, JudyValue > & other ) {
+            std::swap( _judyarray, other._judyarray );
+            std::swap( _arena, other._arena );
+            std::swap( _maxLevels, other._maxLevels );
+            std::swap( _depth, other._depth );
+            std::swap( _lastSlot, other._lastSlot );
+            std::swap( _buff[0], other._buff[0] );
+            std::swap( _success, other._success );
+        }
+
         ///empty the judy array, delete nothing
         ///overload below can also delete JudyValue's, iff they are a pointer type
         void clear() {
-            JudyKey key = 0;
-            while( 0 != ( _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * ) &key, 0 ) ) ) {
-                judy_del( _judyarray );
-            }
+            judy_close( _judyarray );
+            _judyarray = judy_open( _maxLevels, _depth );
+            _arena = 0;
+            _lastSlot = 0;
         }
 #ifdef HAVE_STD_ENABLEIF
         template <typename X=JudyValue>
         typename std::enable_if<std::is_pointer<X>::value, void>::type
         clear( bool deleteContents ) {
             JudyKey key = 0;
-            while( 0 != ( _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * ) &key, 0 ) ) ) {
-                if( deleteContents ) {
-                    delete *_lastSlot;
+            if( deleteContents && _judyarray ) {
+                for( _lastSlot = judy_strt( _judyarray, ( const unsigned char * ) &key, 0 ); _lastSlot; _lastSlot = judy_nxt( _judyarray ) ) {
+                    delete *cell::get( _lastSlot );
                 }
-                judy_del( _judyarray );
             }
+            clear();
         }
 #endif
 
         JudyValue getLastValue() {
             assert( _lastSlot );
-            return &_lastSlot;
+            return *cell::get( _lastSlot );
         }
 
         void setLastValue( JudyValue value ) {
-            assert( _lastSlot );
-            &_lastSlot = value;
+            assert( _lastSlot && cell::storable( value ) );
+            *cell::get( _lastSlot ) = value;
         }
 
         bool success() {
             return _success;
         }
+
+#ifdef JUDY_INSTRUMENT
+        /// structural event counters of the array; iterators count in their own cursors
+        const JudyCounters & counters() const {
+            static const JudyCounters none = JudyCounters();
+            return _judyarray ? _judyarray->counters : none;
+        }
+#endif
         //TODO
         // allocate data memory within judy array for external use.
         // void *judy_data (Judy *judy, unsigned int amt);
 
         /// insert or overwrite value for key
         bool insert( JudyKey key, JudyValue value ) {
-            assert( value != 0 );
-            _lastSlot = ( JudyValue * ) judy_cell( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
-            if( _lastSlot ) {
-                *_lastSlot = value;
-                _success = true;
-            } else {
-                _success = false;
-            }
-            return _success;
+            assert( cell::storable( value ) && "JudyValue's stored in the cell must be non-zero" );
+            _lastSlot = judy_cell( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            return storeLast( value );
+        }
+
+        /** insert or overwrite value for key, like insert(), but faster when keys
+         * arrive in ascending order, such as timestamps: only the levels of the
+         * trie below where key branches off from the most recent key are searched.
+         * Any key may be given; one that is out of order costs what insert() does.
+         */
+        bool push_back( JudyKey key, JudyValue value ) {
+            assert( cell::storable( value ) && "JudyValue's stored in the cell must be non-zero" );
+            _lastSlot = judy_append( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            return storeLast( value );
         }
 
         /// retrieve the cell pointer greater than or equal to given key
         /// NOTE what about an atOrBefore function?
         const pair atOrAfter( JudyKey key ) {
-            _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            // judy_strt can stop at an empty cell whose key bytes match
+            while( _lastSlot && !*_lastSlot ) {
+                _lastSlot = judy_nxt( judy() );
+            }
             return mostRecentPair();
         }
 
-        /// retrieve the cell pointer, or return NULL for a given key.
+        /// retrieve the value for a given key, or a value-initialized JudyValue if not found.
         JudyValue find( JudyKey key ) {
-            _lastSlot = ( JudyValue * ) judy_slot( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size );
-            if( _lastSlot ) {
+            JudyValue * v = findPtr( key );
+            return v ? *v : JudyValue();
+        }
+
+        /** retrieve a pointer to the stored value for a given key, or return NULL.
+         * Afterwards getLastValue() refers to the value found, but the lookup
+         * leaves the array's position alone: next(), previous() and
+         * mostRecentPair() carry on from the last atOrAfter(), begin() etc.
+         */
+        JudyValue * findPtr( JudyKey key ) {
+            _lastSlot = judy_get( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size );
+            if( ( _lastSlot ) && ( * _lastSlot ) ) {
                 _success = true;
-                return *_lastSlot;
+                return cell::get( _lastSlot );
             } else {
                 _success = false;
                 return 0;
@@ -134,12 +330,12 @@ class judyLArray {
 
         /// retrieve the key-value pair for the most recent judy query.
         inline const pair & mostRecentPair() {
-            judy_key( _judyarray, ( unsigned char * ) _buff, _depth * JUDY_key_size );
-            if( _lastSlot ) {
-                _kv.value = *_lastSlot;
+            judy_key( judy(), ( unsigned char * ) _buff, _depth * JUDY_key_size );
+            if( ( _lastSlot ) && ( * _lastSlot ) ) {
+                _kv.value = *cell::get( _lastSlot );
                 _success = true;
             } else {
-                _kv.value = ( JudyValue ) 0;
+                _kv.value = JudyValue();
                 _success = false;
             }
             _kv.key = _buff[0];
@@ -149,45 +345,114 @@ class judyLArray {
         /// retrieve the first key-value pair in the array
         const pair & begin() {
             JudyKey key = 0;
-            _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * ) &key, 0 );
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) &key, 0 );
             return mostRecentPair();
         }
 
         /// retrieve the last key-value pair in the array
         const pair & end() {
-            _lastSlot = ( JudyValue * ) judy_end( _judyarray );
+            _lastSlot = judy_end( judy() );
             return mostRecentPair();
         }
 
         /// retrieve the key-value pair for the next key in the array.
         const pair & next() {
-            _lastSlot = ( JudyValue * ) judy_nxt( _judyarray );
+            _lastSlot = judy_nxt( judy() );
             return mostRecentPair();
         }
 
         /// retrieve the key-value pair for the prev key in the array.
         const pair & previous() {
-            _lastSlot = ( JudyValue * ) judy_prv( _judyarray );
+            _lastSlot = judy_prv( judy() );
             return mostRecentPair();
         }
 
+        /** move to the first key and return a pointer to its value, or NULL if
+         * the array is empty. Unlike begin(), the key is not built; use with
+         * nextValue() to visit the values alone.
+         */
+        JudyValue * firstValue() {
+            JudyKey key = 0;
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) &key, 0 );
+            return lastValuePtr();
+        }
+
+        /// move to the next key and return a pointer to its value, or NULL at the end. The key is not built.
+        JudyValue * nextValue() {
+            _lastSlot = judy_nxt( judy() );
+            return lastValuePtr();
+        }
+
+        /** call f with each value, in key order, without building any keys.
+         * f takes a JudyValue &; it may change the value, but not the array.
+         * A cursor of its own is used, so the most recent query is unaffected.
+         */
+        template< typename Function >
+        void forEachValue( Function f ) {
+            judyCursor c( judy() );
+            for( c.first(); c.slot(); c.next() ) {
+                f( *cell::get( c.slot() ) );
+            }
+        }
+
         /** delete a key-value pair. If the array is not empty,
          * getLastValue() will return the entry before the one that was deleted
          * \sa isEmpty()
          */
-        bool removeEntry( JudyKey * key ) {
-            if( judy_slot( _judyarray, key, _depth * JUDY_key_size ) ) {
-                _lastSlot = ( JudyValue * ) judy_del( _judyarray );
+        bool removeEntry( JudyKey key ) {
+            if( 0 != ( _lastSlot = judy_slot( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) && 0 != *_lastSlot ) {
+                cell::release( _lastSlot, _arena );
+                _lastSlot = judy_del( judy() );
                 return true;
             } else {
                 return false;
             }
         }
 
+        /// iterator at the first key
+        const_iterator cbegin() const {
+            const_iterator it( _judyarray );
+            it.first();
+            return it;
+        }
+
+        /// iterator past the last key
+        const_iterator cend() const {
+            return const_iterator( _judyarray );
+        }
+
+        /// the key-value pairs in key order, for a range-based for loop
+        judyRange< iterator > items() {
+            iterator it( judy() );
+            it.first();
+            return judyRange< iterator >( it, iterator( judy() ) );
+        }
+
+        /// iterator at the first key not less than key, or cend()
+        iterator lower_bound( JudyKey key ) {
+            iterator it( judy() );
+            it.seek( key );
+            return it;
+        }
+
+        /// iterator at the first key greater than key, or cend()
+        iterator upper_bound( JudyKey key ) {
+            iterator it = lower_bound( key );
+            if( it.slot() && it.key() == key ) {
+                ++it;
+            }
+            return it;
+        }
+
         /// true if the array is empty
         bool isEmpty() {
             JudyKey key = 0;
-            return ( ( judy_strt( _judyarray, ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) ? false : true );
+            return ( ( judy_strt( judy(), ( const unsigned char * ) &key, _depth * JUDY_key_size ) ) ? false : true );
         }
 };
+
+template< typename JudyKey, typename JudyValue >
+void swap( judyLArray< JudyKey, JudyValue > & a, judyLArray< JudyKey, JudyValue > & b ) {
+    a.swap( b );
+}
 #endif //JUDYLARRAY_H
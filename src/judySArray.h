@@ -5,45 +5,236 @@
 * \file judySArray.h C++ wrapper for judy array implementation
 *
 *  A judyS array maps strings to corresponding memory cells, each containing
-*  a JudyValue. Each cell must be set to a non-zero value by the caller.
+*  a JudyValue. JudyValue's that are no larger than a pointer are stored in the
+*  cell and must be non-zero; larger ones are stored in memory belonging to the
+*  array.
 *
 *    Author: Mark Pictor. Public domain.
 *
 ********************************************************************************/
 
 #include "judy.h"
+#include "judyArena.h"
+#include "judyCursor.h"
+#include "judyStringKey.h"
 #include "assert.h"
 #include <string.h>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <vector>
+
+#ifdef HAVE_STD_ENABLEIF
+#include <type_traits>
+#endif
 
 template< typename JudyValue >
 struct judysKVpair {
     unsigned char * key;
     JudyValue value;
 };
+/** A judyS array maps strings to corresponding memory cells, each containing
+ * a JudyValue.
+ *
+ * JudyValue may be any trivially copyable type. If it is no larger than a
+ * void* it is stored in the cell itself and must be non-zero; otherwise it is
+ * stored in a block allocated from the array's judy_data() memory, and the
+ * cell points to the block.
+ *
+ * Keys may be passed as a NUL-terminated const char *, with an optional
+ * length, or as a judyStringKey, which std::string and std::string_view
+ * convert to. A key whose length is given is used as is, without strlen().
+ *  \param JudyValue the type of the value
+ */
 template< typename JudyValue >
 class judySArray {
     public:
         typedef judysKVpair< JudyValue > pair;
     protected:
+        typedef judyValueCell< JudyValue > cell;
+#ifdef HAVE_STD_ENABLEIF
+        static_assert( std::is_trivially_copyable< JudyValue >::value, "JudyValue must be trivially copyable" );
+#endif
         Judy * _judyarray;
+        judyArena * _arena;
         unsigned int _maxKeyLen;
-        JudyValue * _lastSlot;
+        JudySlot * _lastSlot;
         unsigned char * _buff;
         bool _success;
         pair _kv;
+
+        /// the judy array, opened again if this array has been moved from
+        Judy * judy() {
+            if( !_judyarray ) {
+                _judyarray = judy_open( _maxKeyLen, 0 );
+            }
+            if( !_buff ) {
+                _buff = new unsigned char[_maxKeyLen + 1];
+            }
+            return _judyarray;
+        }
+
+        /// insert every key and its value(s) from other; other is traversed with a cursor of its own
+        void copyFrom( const judySArray< JudyValue > & other ) {
+            JudySlot * slot = 0;
+            unsigned int len = 0;
+            Judy * cursor = other._judyarray ? judy_cursor( other._judyarray ) : 0;
+            _success = ( cursor != 0 || !other._judyarray );
+            _buff[0] = '\0';
+            if( cursor && ( slot = judy_strt( cursor, ( const unsigned char * ) _buff, 0 ) ) ) {
+                len = judy_key( cursor, _buff, _maxKeyLen + 1 );
+            }
+            for( ; slot && _success; slot = judy_nxt_key( cursor, _buff, _maxKeyLen + 1, &len ) ) {
+                JudyValue * v = 0;
+                _lastSlot = judy_append( judy(), _buff, len );
+                if( _lastSlot && ( v = cell::make( _lastSlot, judy(), _arena ) ) ) {
+                    *v = *cell::get( slot );
+                } else {
+                    _success = false;
+                }
+            }
+            judy_cursor_close( cursor );
+            _lastSlot = 0;
+        }
+
+        /// store value in _lastSlot, which is from judy_cell or judy_append; sets _success
+        bool storeLast( JudyValue value ) {
+            JudyValue * v = 0;
+            if( _lastSlot && ( v = cell::make( _lastSlot, judy(), _arena ) ) ) {
+                *v = value;
+                _success = true;
+            } else {
+                _success = false;
+            }
+            return _success;
+        }
+
+        /// the value for _lastSlot, or NULL; sets _success
+        JudyValue * lastValuePtr() {
+            _success = ( _lastSlot != 0 );
+            return _lastSlot ? cell::get( _lastSlot ) : 0;
+        }
     public:
-        judySArray( unsigned int maxKeyLen ): _maxKeyLen( maxKeyLen ), _success( true ) {
+        /** A bidirectional iterator over the key-value pairs, in key order.
+         * Each iterator has a cursor of its own, so several can be used at once,
+         * and with <algorithm>; the most recent query of the array is unaffected.
+         * The key is only built when it is asked for, or the iterator is
+         * dereferenced, in a buffer belonging to the iterator; after that, it is
+         * updated incrementally as the iterator moves. Iterators are invalidated
+         * by any insertion or deletion.
+         */
+        template< bool isConst >
+        class iter: public judyCursor {
+            protected:
+                mutable pair _pair;
+            public:
+                typedef std::bidirectional_iterator_tag iterator_category;
+                typedef pair value_type;
+                typedef ptrdiff_t difference_type;
+                typedef const pair * pointer;
+                typedef const pair & reference;
+
+                explicit iter( Judy * judy = 0 ): judyCursor( judy ) {
+                }
+
+                /// an iterator converts to a const_iterator
+                iter( const iter< false > & other ): judyCursor( other ) {
+                }
+
+                /// the key, NUL-terminated; valid until the iterator is changed
+                const char * key() const {
+                    return keyView().data();
+                }
+
+                /// the key and its length, which converts to std::string_view; valid until the iterator is changed
+                judyStringKey keyView() const {
+                    unsigned int len;
+                    const unsigned char * k = keyBytes( len );
+                    return judyStringKey( ( const char * ) k, len );
+                }
+
+                typename judyReference< isConst, JudyValue >::type value() const {
+                    return *cell::get( _slot );
+                }
+
+                reference operator*() const {
+                    _pair.key = ( unsigned char * ) key();
+                    _pair.value = value();
+                    return _pair;
+                }
+
+                pointer operator->() const {
+                    return &**this;
+                }
+
+                iter & operator++() {
+                    next();
+                    return *this;
+                }
+
+                iter operator++( int ) {
+                    iter tmp( *this );
+                    next();
+                    return tmp;
+                }
+
+                iter & operator--() {
+                    prev();
+                    return *this;
+                }
+
+                iter operator--( int ) {
+                    iter tmp( *this );
+                    prev();
+                    return tmp;
+                }
+
+                /** move to the first key not less than key, or to the end.
+                 * Only the part of the trie below where key branches off from
+                 * the current key is searched, so seeking forward through
+                 * nearby keys in order is much cheaper than lower_bound().
+                 */
+                iter & seek( const judyStringKey & key ) {
+                    judyCursor::seek( key.bytes(), key.size() );
+                    return *this;
+                }
+        };
+        typedef iter< false > iterator;
+        typedef iter< true > const_iterator;
+
+        judySArray( unsigned int maxKeyLen ): _arena( 0 ), _maxKeyLen( maxKeyLen ), _lastSlot( 0 ), _success( true ) {
+            _judyarray = judy_open( _maxKeyLen, 0 );
+            _buff = new unsigned char[_maxKeyLen + 1];
+        }
+
+        /// deep copy: the copy has its own nodes and values, and no most recent query
+        explicit judySArray( const judySArray< JudyValue > & other ): _arena( 0 ), _maxKeyLen( other._maxKeyLen ), _lastSlot( 0 ), _success( true ) {
             _judyarray = judy_open( _maxKeyLen, 0 );
-            _buff = new unsigned char[_maxKeyLen];
-            assert( sizeof( JudyValue ) == sizeof( this ) && "JudyValue *must* be the same size as a pointer!" );
+            _buff = new unsigned char[_maxKeyLen + 1];
+            copyFrom( other );
+        }
+
+#ifdef HAVE_STD_ENABLEIF
+        /// take over the contents of other. other is left empty; its judy array is opened again when it is next used
+        judySArray( judySArray< JudyValue > && other ) noexcept: _judyarray( 0 ), _arena( 0 ), _maxKeyLen( other._maxKeyLen ), _lastSlot( 0 ),
+            _buff( 0 ), _success( true ) {
+            swap( other );
         }
 
-        explicit judySArray( const judySArray< JudyValue > & other ): _maxKeyLen( other._maxKeyLen ), _success( other._success ) {
-            _judyarray = judy_clone( other._judyarray );
-            _buff = new unsigned char[_maxKeyLen];
-            strncpy( _buff, other._buff, _maxKeyLen );
-            _buff[ _maxKeyLen ] = '\0'; //ensure that _buff is null-terminated, since strncpy won't necessarily do so
-            find( _buff ); //set _lastSlot
+        judySArray & operator=( judySArray< JudyValue > && other ) noexcept {
+            judySArray< JudyValue > tmp( std::move( other ) );
+            swap( tmp );
+            return *this;
+        }
+#endif
+
+        /// replace the contents with a deep copy of other
+        judySArray & operator=( const judySArray< JudyValue > & other ) {
+            if( this != &other ) {
+                judySArray< JudyValue > tmp( other );
+                swap( tmp );
+            }
+            return *this;
         }
 
         ~judySArray() {
@@ -51,74 +242,118 @@ class judySArray {
             delete[] _buff;
         }
 
+        /// exchange the contents of two arrays; no keys or values are copied
+        void swap( judySArray< JudyValue > & other ) {
+            std::swap( _judyarray, other._judyarray );
+            std::swap( _arena, other._arena );
+            std::swap( _maxKeyLen, other._maxKeyLen );
+            std::swap( _lastSlot, other._lastSlot );
+            std::swap( _buff, other._buff );
+            std::swap( _success, other._success );
+        }
+
         void clear() {
-            _buff[0] = '\0';
-            while( 0 != ( _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * ) _buff, 0 ) ) ) {
-                judy_del( _judyarray );
+            judy_close( _judyarray );
+            _judyarray = judy_open( _maxKeyLen, 0 );
+            _arena = 0;
+            _lastSlot = 0;
+            if( !_buff ) {
+                _buff = new unsigned char[_maxKeyLen + 1];
             }
         }
 
         JudyValue getLastValue() {
             assert( _lastSlot );
-            return &_lastSlot;
+            return *cell::get( _lastSlot );
         }
 
         void setLastValue( JudyValue value ) {
-            assert( _lastSlot );
-            &_lastSlot = value;
+            assert( _lastSlot && cell::storable( value ) );
+            *cell::get( _lastSlot ) = value;
         }
 
         bool success() {
             return _success;
         }
+
+#ifdef JUDY_INSTRUMENT
+        /// structural event counters of the array; iterators count in their own cursors
+        const JudyCounters & counters() const {
+            static const JudyCounters none = JudyCounters();
+            return _judyarray ? _judyarray->counters : none;
+        }
+#endif
         //TODO
         // allocate data memory within judy array for external use.
         // void *judy_data (Judy *judy, unsigned int amt);
 
-        /// insert or overwrite value for key
+        /// insert or overwrite value for key. If keyLen is 0, key must be NUL-terminated
         bool insert( const char * key, JudyValue value, unsigned int keyLen = 0 ) {
-            assert( value != 0 );
-            if( keyLen == 0 ) {
-                keyLen = strlen( key );
-            } else {
-                assert( keyLen == strlen( key ) );
-            }
-            assert( keyLen <= _maxKeyLen );
-            _lastSlot = ( JudyValue * ) judy_cell( _judyarray, ( const unsigned char * )key, keyLen );
-            if( _lastSlot ) {
-                *_lastSlot = value;
-                _success = true;
-            } else {
-                _success = false;
-            }
-            return _success;
+            return insert( keyLen ? judyStringKey( key, keyLen ) : judyStringKey( key ), value );
+        }
+
+        /// insert or overwrite value for key
+        bool insert( const judyStringKey & key, JudyValue value ) {
+            assert( cell::storable( value ) && "JudyValue's stored in the cell must be non-zero" );
+            assert( key.size() <= _maxKeyLen );
+            _lastSlot = judy_cell( judy(), key.bytes(), key.size() );
+            return storeLast( value );
+        }
+
+        /** insert or overwrite value for key, like insert(), but faster when keys
+         * arrive in sorted order: only the levels of the trie below where key
+         * branches off from the most recent key are searched. Any key may be
+         * given; one that is out of order costs what insert() does.
+         */
+        bool push_back( const judyStringKey & key, JudyValue value ) {
+            assert( cell::storable( value ) && "JudyValue's stored in the cell must be non-zero" );
+            assert( key.size() <= _maxKeyLen );
+            _lastSlot = judy_append( judy(), key.bytes(), key.size() );
+            return storeLast( value );
         }
 
         /// retrieve the cell pointer greater than or equal to given key
         /// NOTE what about an atOrBefore function?
         const pair atOrAfter( const char * key, unsigned int keyLen = 0 ) {
-            if( keyLen == 0 ) {
-                keyLen = strlen( key );
-            } else {
-                assert( keyLen == strlen( key ) );
+            return atOrAfter( keyLen ? judyStringKey( key, keyLen ) : judyStringKey( key ) );
+        }
+
+        const pair atOrAfter( const judyStringKey & key ) {
+            assert( key.size() <= _maxKeyLen );
+            _lastSlot = judy_strt( judy(), key.bytes(), key.size() );
+            // judy_strt can stop at an empty cell whose key bytes match
+            while( _lastSlot && !*_lastSlot ) {
+                _lastSlot = judy_nxt( judy() );
             }
-            assert( keyLen <= _maxKeyLen );
-            _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * )key, keyLen );
             return mostRecentPair();
         }
 
-        /// retrieve the cell pointer, or return NULL for a given key.
+        /// retrieve the value for a given key, or a value-initialized JudyValue if not found.
         JudyValue find( const char * key, unsigned int keyLen = 0 ) {
-            if( keyLen == 0 ) {
-                keyLen = strlen( key );
-            } else {
-                assert( keyLen == strlen( key ) );
-            }
-            assert( keyLen <= _maxKeyLen );
-            _lastSlot = ( JudyValue * ) judy_slot( _judyarray, ( const unsigned char * ) key, keyLen );
-            if( _lastSlot ) {
+            JudyValue * v = findPtr( key, keyLen );
+            return v ? *v : JudyValue();
+        }
+
+        JudyValue find( const judyStringKey & key ) {
+            JudyValue * v = findPtr( key );
+            return v ? *v : JudyValue();
+        }
+
+        /** retrieve a pointer to the stored value for a given key, or return NULL.
+         * Afterwards getLastValue() refers to the value found, but the lookup
+         * leaves the array's position alone: next(), previous() and
+         * mostRecentPair() carry on from the last atOrAfter(), begin() etc.
+         */
+        JudyValue * findPtr( const char * key, unsigned int keyLen = 0 ) {
+            return findPtr( keyLen ? judyStringKey( key, keyLen ) : judyStringKey( key ) );
+        }
+
+        JudyValue * findPtr( const judyStringKey & key ) {
+            assert( key.size() <= _maxKeyLen );
+            _lastSlot = judy_get( judy(), key.bytes(), key.size() );
+            if( ( _lastSlot ) && ( * _lastSlot ) ) {
                 _success = true;
-                return *_lastSlot;
+                return cell::get( _lastSlot );
             } else {
                 _success = false;
                 return 0;
@@ -127,12 +362,13 @@ class judySArray {
 
         /// retrieve the key-value pair for the most recent judy query.
         inline const pair & mostRecentPair() {
-            judy_key( _judyarray, _buff, _maxKeyLen );
-            if( _lastSlot ) {
-                _kv.value = *_lastSlot;
+            Judy * array = judy();    // allocates _buff as well
+            judy_key( array, _buff, _maxKeyLen + 1 );
+            if( ( _lastSlot ) && ( * _lastSlot ) ) {
+                _kv.value = *cell::get( _lastSlot );
                 _success = true;
             } else {
-                _kv.value = ( JudyValue ) 0;
+                _kv.value = JudyValue();
                 _success = false;
             }
             _kv.key = _buff;
@@ -141,46 +377,118 @@ class judySArray {
 
         /// retrieve the first key-value pair in the array
         const pair & begin() {
-            _buff[0] = '\0';
-            _lastSlot = ( JudyValue * ) judy_strt( _judyarray, ( const unsigned char * ) _buff, 0 );
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) "", 0 );
             return mostRecentPair();
         }
 
         /// retrieve the last key-value pair in the array
         const pair & end() {
-            _lastSlot = ( JudyValue * ) judy_end( _judyarray );
+            _lastSlot = judy_end( judy() );
             return mostRecentPair();
         }
 
         /// retrieve the key-value pair for the next key in the array.
         const pair & next() {
-            _lastSlot = ( JudyValue * ) judy_nxt( _judyarray );
+            _lastSlot = judy_nxt( judy() );
             return mostRecentPair();
         }
 
         /// retrieve the key-value pair for the prev key in the array.
         const pair & previous() {
-            _lastSlot = ( JudyValue * ) judy_prv( _judyarray );
+            _lastSlot = judy_prv( judy() );
             return mostRecentPair();
         }
 
+        /** move to the first key and return a pointer to its value, or NULL if
+         * the array is empty. Unlike begin(), the key is not built; use with
+         * nextValue() to visit the values alone.
+         */
+        JudyValue * firstValue() {
+            _lastSlot = judy_strt( judy(), ( const unsigned char * ) "", 0 );
+            return lastValuePtr();
+        }
+
+        /// move to the next key and return a pointer to its value, or NULL at the end. The key is not built.
+        JudyValue * nextValue() {
+            _lastSlot = judy_nxt( judy() );
+            return lastValuePtr();
+        }
+
+        /** call f with each value, in key order, without building any keys.
+         * f takes a JudyValue &; it may change the value, but not the array.
+         * A cursor of its own is used, so the most recent query is unaffected.
+         */
+        template< typename Function >
+        void forEachValue( Function f ) {
+            judyCursor c( judy() );
+            for( c.first(); c.slot(); c.next() ) {
+                f( *cell::get( c.slot() ) );
+            }
+        }
+
         /** delete a key-value pair. If the array is not empty,
          * getLastValue() will return the entry before the one that was deleted
          * \sa isEmpty()
          */
-        bool removeEntry( const char * key ) {
-            if( judy_slot( _judyarray, ( const unsigned char * )key, strlen( key ) ) ) {
-                _lastSlot = ( JudyValue * ) judy_del( _judyarray );
+        bool removeEntry( const char * key, unsigned int keyLen = 0 ) {
+            return removeEntry( keyLen ? judyStringKey( key, keyLen ) : judyStringKey( key ) );
+        }
+
+        bool removeEntry( const judyStringKey & key ) {
+            assert( key.size() <= _maxKeyLen );
+            if( 0 != ( _lastSlot = judy_slot( judy(), key.bytes(), key.size() ) ) && 0 != *_lastSlot ) {
+                cell::release( _lastSlot, _arena );
+                _lastSlot = judy_del( judy() );
                 return true;
             } else {
                 return false;
             }
         }
 
+        /// iterator at the first key
+        const_iterator cbegin() const {
+            const_iterator it( _judyarray );
+            it.first();
+            return it;
+        }
+
+        /// iterator past the last key
+        const_iterator cend() const {
+            return const_iterator( _judyarray );
+        }
+
+        /// the key-value pairs in key order, for a range-based for loop
+        judyRange< iterator > items() {
+            iterator it( judy() );
+            it.first();
+            return judyRange< iterator >( it, iterator( judy() ) );
+        }
+
+        /// iterator at the first key not less than key, or cend()
+        iterator lower_bound( const judyStringKey & key ) {
+            iterator it( judy() );
+            assert( key.size() <= _maxKeyLen );
+            it.seek( key );
+            return it;
+        }
+
+        /// iterator at the first key greater than key, or cend()
+        iterator upper_bound( const judyStringKey & key ) {
+            iterator it = lower_bound( key );
+            if( it.slot() && it.keyView() == key ) {
+                ++it;
+            }
+            return it;
+        }
+
         ///return true if the array is empty
         bool isEmpty() {
-            _buff[0] = 0;
-            return ( ( judy_strt( _judyarray, ( const unsigned char * ) _buff, 0 ) ) ? false : true );
+            return ( ( judy_strt( judy(), ( const unsigned char * ) "", 0 ) ) ? false : true );
         }
 };
+
+template< typename JudyValue >
+void swap( judySArray< JudyValue > & a, judySArray< JudyValue > & b ) {
+    a.swap( b );
+}
 #endif //JUDYSARRAY_H
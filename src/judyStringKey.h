@@ -0,0 +1,78 @@
+#ifndef JUDYSTRINGKEY_H
+#define JUDYSTRINGKEY_H
+
+/****************************************************************************//**
+* \file judyStringKey.h a string key for judySArray and judyS2Array
+*
+* judyStringKey is a pointer and a length, so that a key can be passed to the
+* string templates without a NUL terminator and without being rescanned. It
+* converts implicitly from std::string and, with C++17, std::string_view, and
+* converts back to std::string_view.
+*
+*    Public domain.
+*
+********************************************************************************/
+
+#include <string.h>
+#include <string>
+
+#ifdef HAVE_STD_STRING_VIEW
+#include <string_view>
+#endif
+
+/** A read-only (pointer, length) view of a string key. The characters need
+ * not be NUL-terminated, but must not include a NUL: judy string keys end at
+ * the first one.
+ */
+class judyStringKey {
+    protected:
+        const char * _data;
+        unsigned int _size;
+    public:
+        /// a NUL-terminated key; its length is found with strlen()
+        judyStringKey( const char * key ): _data( key ), _size( ( unsigned int ) strlen( key ) ) {
+        }
+
+        /// the first len characters of key
+        judyStringKey( const char * key, unsigned int len ): _data( key ), _size( len ) {
+        }
+
+        judyStringKey( const std::string & key ): _data( key.data() ), _size( ( unsigned int ) key.size() ) {
+        }
+
+#ifdef HAVE_STD_STRING_VIEW
+        judyStringKey( std::string_view key ): _data( key.data() ), _size( ( unsigned int ) key.size() ) {
+        }
+
+        operator std::string_view() const {
+            return std::string_view( _data, _size );
+        }
+#endif
+
+        const char * data() const {
+            return _data;
+        }
+
+        /// the key as judy_cell(), judy_slot() etc expect it
+        const unsigned char * bytes() const {
+            return ( const unsigned char * ) _data;
+        }
+
+        unsigned int size() const {
+            return _size;
+        }
+
+        std::string str() const {
+            return std::string( _data, _size );
+        }
+
+        bool operator==( const judyStringKey & other ) const {
+            return _size == other._size && !memcmp( _data, other._data, _size );
+        }
+
+        bool operator!=( const judyStringKey & other ) const {
+            return !( *this == other );
+        }
+};
+
+#endif //JUDYSTRINGKEY_H
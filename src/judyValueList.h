@@ -0,0 +1,247 @@
+#ifndef JUDYVALUELIST_H
+#define JUDYVALUELIST_H
+
+/****************************************************************************//**
+* \file judyValueList.h value storage for judyL2Array and judyS2Array
+*
+* judyValueList holds the values for one key of a multi-value judy array. The
+* first few values are stored inline, in a small block allocated from the
+* array's judyArena; beyond that they spill to a std::vector that, along with
+* its elements, is also allocated from the arena. judyValueSpan is a read-only
+* view of the values, whichever representation is in use.
+*
+*    Public domain.
+*
+********************************************************************************/
+
+#include "judy.h"
+#include "judyArena.h"
+#include "assert.h"
+#include <stdexcept>
+#include <vector>
+#include <new>
+
+#ifdef HAVE_STD_ENABLEIF
+#include <type_traits>
+#endif
+
+/** A read-only view of contiguous JudyValue's, similar to std::span.
+ * Valid until the values it refers to are modified.
+ */
+template< typename JudyValue >
+class judyValueSpan {
+    public:
+        typedef JudyValue value_type;
+        typedef size_t size_type;
+        typedef const JudyValue & const_reference;
+        typedef const JudyValue * const_iterator;
+        typedef const_iterator iterator;
+    protected:
+        const JudyValue * _data;
+        size_t _size;
+    public:
+        judyValueSpan(): _data( 0 ), _size( 0 ) {
+        }
+
+        judyValueSpan( const JudyValue * data, size_t size ): _data( data ), _size( size ) {
+        }
+
+        const_iterator begin() const {
+            return _data;
+        }
+
+        const_iterator end() const {
+            return _data + _size;
+        }
+
+        const JudyValue * data() const {
+            return _data;
+        }
+
+        size_t size() const {
+            return _size;
+        }
+
+        bool empty() const {
+            return !_size;
+        }
+
+        const JudyValue & operator[]( size_t i ) const {
+            assert( i < _size );
+            return _data[i];
+        }
+
+        /// like std::vector::at(), throws std::out_of_range if i is not a valid index
+        const JudyValue & at( size_t i ) const {
+            if( i >= _size ) {
+                throw std::out_of_range( "judyValueSpan::at" );
+            }
+            return _data[i];
+        }
+
+        const JudyValue & front() const {
+            return at( 0 );
+        }
+
+        const JudyValue & back() const {
+            return at( _size - 1 );
+        }
+};
+
+/** The values stored for one key of a judyL2Array or judyS2Array.
+ * Up to N values are stored inline; the N+1'th value moves them all into a
+ * std::vector, which is used from then on.
+ *
+ * A judyValueList is constructed with placement new in a block from a
+ * judyArena, and the judy cell for the key points to it. The vector is placed
+ * in the arena the same way, and allocates its elements from the arena. If
+ * JudyValue is trivially destructible, the lists need not be destroyed at all:
+ * closing the judy array frees them, their vectors, and the values at once.
+ *
+ * Use the static functions to manage the list for a cell.
+ */
+template< typename JudyValue, unsigned int N >
+class judyValueList {
+    public:
+        typedef std::vector< JudyValue > vector;
+        typedef judyValueSpan< JudyValue > span;
+
+        /// true if the lists can be discarded along with the arena, without being destroyed
+#ifdef HAVE_STD_ENABLEIF
+        static const bool trivial = std::is_trivially_destructible< JudyValue >::value;
+#else
+        static const bool trivial = false;
+#endif
+    protected:
+        typedef std::vector< JudyValue, judyArenaAllocator< JudyValue > > spillVector;
+        static const unsigned int Spilled = ~0u;
+
+        unsigned int _count;    ///< number of values stored inline, or Spilled
+        union {
+            spillVector * _spill;
+            JudySlot _align;
+#ifdef HAVE_STD_ENABLEIF
+            alignas( JudyValue ) unsigned char _inline[N * sizeof( JudyValue )];
+#else
+            long double _alignWide;    ///< without alignas, the widest alignment of the basic types
+            unsigned char _inline[N * sizeof( JudyValue )];
+#endif
+        };
+
+        judyValueList(): _count( 0 ) {
+        }
+
+        JudyValue * inlineValues() {
+            return ( JudyValue * ) _inline;
+        }
+
+        const JudyValue * inlineValues() const {
+            return ( const JudyValue * ) _inline;
+        }
+
+        void destroyInline() {
+            while( _count ) {
+                inlineValues()[--_count].~JudyValue();
+            }
+        }
+
+        /// move the inline values to a vector in the arena, making room for value
+        void spill( const JudyValue & value, judyArena * arena ) {
+            void * mem = arena->alloc( sizeof( spillVector ) );
+            if( !mem ) {
+                throw std::bad_alloc();
+            }
+            spillVector * v = new( mem ) spillVector( judyArenaAllocator< JudyValue >( arena ) );
+            v->reserve( 2 * N + 1 );
+            v->insert( v->end(), inlineValues(), inlineValues() + _count );
+            v->push_back( value );
+            destroyInline();
+            _spill = v;
+            _count = Spilled;
+        }
+    public:
+        /// the values in the list
+        span values() const {
+            if( _count != Spilled ) {
+                return span( inlineValues(), _count );
+            } else if( _spill->empty() ) {
+                return span();
+            }
+            return span( &( *_spill )[0], _spill->size() );
+        }
+
+        /// append value; arena must be the one the list was allocated from
+        void push_back( const JudyValue & value, judyArena * arena ) {
+            if( _count < N ) {
+                new( inlineValues() + _count ) JudyValue( value );
+                _count++;
+            } else if( _count == N ) {
+                spill( value, arena );
+            } else {
+                _spill->push_back( value );
+            }
+        }
+
+        template< typename InputIterator >
+        void append( InputIterator first, InputIterator last, judyArena * arena ) {
+            for( ; first != last; ++first ) {
+                push_back( *first, arena );
+            }
+        }
+
+        /// remove all values. A spilled list keeps its vector.
+        void clear() {
+            if( _count == Spilled ) {
+                _spill->clear();
+            } else {
+                destroyInline();
+            }
+        }
+
+        /// the list for an occupied cell
+        static judyValueList * get( JudySlot * cell ) {
+            return ( judyValueList * ) *cell;
+        }
+
+        /// the list for a cell returned by judy_cell(), creating an empty one if necessary
+        static judyValueList * make( JudySlot * cell, Judy * judy, judyArena *& arena ) {
+            void * mem;
+            if( !*cell ) {
+                if( !arena && !( arena = judyArena::open( judy ) ) ) {
+                    return 0;
+                }
+                if( !( mem = arena->alloc( sizeof( judyValueList ) ) ) ) {
+                    return 0;
+                }
+                *cell = ( JudySlot ) new( mem ) judyValueList;
+            }
+            return get( cell );
+        }
+
+        /// run the destructors of the values in the list for an occupied cell, leaving its memory in the arena
+        static void destroy( JudySlot * cell ) {
+            judyValueList * list = get( cell );
+            if( list->_count == Spilled ) {
+                list->_spill->~spillVector();
+            } else {
+                list->destroyInline();
+            }
+        }
+
+        /// destroy the list for a cell, returning its memory to the arena; nothing to do for an empty cell
+        static void release( JudySlot * cell, judyArena * arena ) {
+            judyValueList * list = get( cell );
+            if( !list || !arena ) {
+                return;
+            }
+            if( list->_count == Spilled ) {
+                list->_spill->~spillVector();
+                arena->release( list->_spill, sizeof( spillVector ) );
+            } else {
+                list->destroyInline();
+            }
+            arena->release( list, sizeof( judyValueList ) );
+        }
+};
+
+#endif //JUDYVALUELIST_H
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <stdint.h>
 #include <stdlib.h>
+#include <iterator>
 
 #include "judyL2Array.h"
 typedef judyL2Array< uint64_t, uint64_t > jl2a;
@@ -18,7 +19,7 @@ bool testFind( jl2a & j, uint64_t key, unsigned int count ) {
             return false;
         } else {
             // note - this doesn't verify that the right keys are returned, just the right number!
-            jl2a::vector::const_iterator it = v->begin();
+            jl2a::cvector::const_iterator it = v->begin();
             std::cout << "    correct number of values -";
             for( ; it != v->end(); it++ ) {
                 std::cout << " " << *it;
@@ -59,6 +60,96 @@ int main() {
     pass &= testFind( jl, 11, 1 );
     pass &= testFind( jl, 7,  2 );
 
+    // more values than are stored inline
+    for( uint64_t i = 0; i < 20; i++ ) {
+        jl.insert( 7, 1000 + i );
+    }
+    pass &= testFind( jl, 7,  22 );
+    jl2a::cvector * v = jl.find( 7 );
+    if( !v || v->at( 0 ) != 312 || v->at( 1 ) != 313 || v->back() != 1019 ) {
+        std::cout << "values for key 7 are out of order" << std::endl;
+        pass = false;
+    }
+    jl2a::vector values( 3, 42 );
+    jl.insert( 7, values, true );
+    pass &= testFind( jl, 7,  3 );
+    pass &= ( jl.removeEntry( 7 ) && testFind( jl, 7, 0 ) );
+
+    // key 0 is absent, although judy_slot can stop at an empty cell for it
+    if( jl.removeEntry( 0 ) || jl.atOrAfter( 0 ).key != 5 ) {
+        std::cout << "key 0: found in an array without it" << std::endl;
+        pass = false;
+    }
+    pass &= testFind( jl, 0, 0 );
+
+#ifdef HAVE_STD_ENABLEIF
+    // inline values are aligned for their type
+    judyL2Array< uint64_t, long double > jw;
+    for( uint64_t i = 1; i <= 20; i++ ) {
+        jw.insert( i, ( long double ) i );
+    }
+    for( uint64_t i = 1; i <= 20; i++ ) {
+        const long double * w = jw.find( i )->data();
+        if( ( uintptr_t ) w % alignof( long double ) || ( uint64_t ) *w != i ) {
+            std::cout << "inline values: misaligned for key " << i << std::endl;
+            pass = false;
+            break;
+        }
+    }
+#endif
+
+    // copies are deep; swap and move hand over the contents
+    for( uint64_t i = 0; i < 20; i++ ) {
+        jl.insert( 9, i );
+    }
+    jl2a jc( jl );
+    jc.insert( 9, 20 );
+    jc.removeEntry( 11 );
+    pass &= testFind( jl, 9, 20 ) && testFind( jl, 11, 1 ) && testFind( jc, 9, 21 );
+    jl2a jd;
+    jd = jc;
+    jd.swap( jl );
+    pass &= testFind( jl, 11, 0 ) && testFind( jd, 11, 1 );
+#ifdef HAVE_STD_ENABLEIF
+    jl2a jm( std::move( jd ) );
+    jd = std::move( jm );
+    pass &= testFind( jd, 9, 20 );
+#endif
+
+    // iterators have cursors of their own and leave the array's state alone
+    jl2a::const_iterator it = jl.cbegin();
+    jl2a::const_iterator last = jl.cend();
+    --last;
+    if( it.key() != 5 || it->value->at( 0 ) != 12 || last.key() != 9 || last.value().size() != 21 ) {
+        std::cout << "iterator: wrong first or last pair" << std::endl;
+        pass = false;
+    }
+    if( jl.lower_bound( 7 ).key() != 9 || jl.upper_bound( 6 ).key() != 9 || jl.upper_bound( 9 ) != jl.cend() ) {
+        std::cout << "lower_bound/upper_bound: wrong position" << std::endl;
+        pass = false;
+    }
+
+    // value-only traversal
+    size_t count = 0, keys = 0;
+    for( jl2a::cvector * vs = jl.firstValue(); vs; vs = jl.nextValue() ) {
+        count += vs->size();
+        keys++;
+    }
+#ifdef HAVE_STD_ENABLEIF
+    size_t count2 = 0;
+    jl.forEachValue( [&count2]( jl2a::cvector & vs ) {
+        count2 += vs.size();
+    } );
+    if( count2 != count ) {
+        std::cout << "forEachValue: wrong number of values" << std::endl;
+        pass = false;
+    }
+#endif
+    if( keys != ( size_t ) std::distance( jl.cbegin(), jl.cend() ) ) {
+        std::cout << "firstValue/nextValue: wrong number of keys" << std::endl;
+        pass = false;
+    }
+
     jl.clear();
 
     //TODO test all of judyL2Array
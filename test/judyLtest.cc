@@ -1,9 +1,442 @@
 #include <iostream>
 #include <stdint.h>
 #include <stdlib.h>
+#include <vector>
+#include <iterator>
 
 #include "judyLArray.h"
 
+struct record {
+    uint64_t a, b, c;
+};
+
+/// values larger than a pointer are stored in the array's own memory
+bool testRecords() {
+    judyLArray< uint64_t, record > jr;
+    for( uint64_t i = 0; i < 1000; i++ ) {
+        record r = { i, i * 2, i * 3 };
+        jr.insert( i * 7, r );
+    }
+    record * p = jr.findPtr( 70 );
+    if( !p || p->a != 10 || p->b != 20 || p->c != 30 ) {
+        std::cout << "findPtr: wrong record for key 70" << std::endl;
+        return false;
+    }
+    p->c = 31;
+    if( jr.find( 70 ).c != 31 ) {
+        std::cout << "find: record not updated in place" << std::endl;
+        return false;
+    }
+    if( jr.findPtr( 71 ) || jr.success() ) {
+        std::cout << "findPtr: false positive for key 71" << std::endl;
+        return false;
+    }
+    // lookups leave the array's position alone
+    jr.begin();
+    if( !jr.findPtr( 700 ) || jr.getLastValue().a != 100 || jr.next().key != 7 ) {
+        std::cout << "findPtr: array position moved" << std::endl;
+        return false;
+    }
+    record zero = { 0, 0, 0 };
+    jr.insert( 71, zero );
+    if( !jr.findPtr( 71 ) ) {
+        std::cout << "insert: zero-valued record not stored" << std::endl;
+        return false;
+    }
+    if( !jr.removeEntry( 70 ) || jr.findPtr( 70 ) ) {
+        std::cout << "removeEntry: record for key 70 not removed" << std::endl;
+        return false;
+    }
+    jr.clear();
+    return jr.isEmpty();
+}
+
+/// copies are deep; moves and swaps hand over the nodes without copying
+bool testCopyMove() {
+    judyLArray< uint64_t, record > a;
+    for( uint64_t i = 0; i < 1000; i++ ) {
+        record r = { i, i * 2, i * 3 };
+        a.insert( i * 7, r );
+    }
+    judyLArray< uint64_t, record > b( a );
+    b.findPtr( 70 )->a = 99;
+    b.removeEntry( 7 );
+    if( a.find( 70 ).a != 10 || !a.findPtr( 7 ) || b.find( 6993 ).c != 2997 ) {
+        std::cout << "copy: not a deep copy" << std::endl;
+        return false;
+    }
+    judyLArray< uint64_t, record > c;
+    c = b;
+    c.swap( a );
+    if( c.find( 70 ).a != 10 || a.find( 70 ).a != 99 || a.findPtr( 7 ) ) {
+        std::cout << "swap: contents not exchanged" << std::endl;
+        return false;
+    }
+#ifdef HAVE_STD_ENABLEIF
+    std::vector< judyLArray< uint64_t, record > > v;
+    v.push_back( std::move( a ) );
+    v.push_back( std::move( c ) );
+    v.resize( 10 );
+    if( v[0].find( 70 ).a != 99 || v[1].find( 70 ).a != 10 || !v[9].isEmpty() ) {
+        std::cout << "move: contents lost" << std::endl;
+        return false;
+    }
+    a = std::move( v[1] );
+    if( a.find( 6993 ).c != 2997 ) {
+        std::cout << "move assignment: contents lost" << std::endl;
+        return false;
+    }
+    const judyLArray< uint64_t, record > & moved = c;
+    judyLArray< uint64_t, record > copied( moved );
+    if( moved.cbegin() != moved.cend() || !copied.isEmpty() ) {
+        std::cout << "move: moved-from array not empty" << std::endl;
+        return false;
+    }
+    if( !c.isEmpty() || c.findPtr( 70 ) || c.cbegin() != c.cend() || !v[1].isEmpty() ) {
+        std::cout << "move: moved-from array not empty" << std::endl;
+        return false;
+    }
+    c.insert( 1, record() );
+    v[1].insert( 2, record() );
+    if( !c.findPtr( 1 ) || !v[1].findPtr( 2 ) ) {
+        std::cout << "move: moved-from array not usable" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+/// keys in ascending order, with some out of order and some repeated
+bool testPushBack() {
+    judyLArray< uint64_t, uint64_t > ja;
+    uint64_t key = 1000000;
+    for( uint64_t i = 1; i <= 100000; i++ ) {
+        key += 1 + ( i * 7919 ) % 1000;
+        ja.push_back( key, i );
+        if( i % 1000 == 0 ) {
+            ja.push_back( i, i );
+            ja.push_back( key, i );
+        }
+    }
+    if( ja.find( key ) != 100000 || ja.find( 5000 ) != 5000 || ja.find( 1000 + 1 ) ) {
+        std::cout << "push_back: wrong value" << std::endl;
+        return false;
+    }
+    uint64_t n = 0, prev = 0;
+    for( judyLArray< uint64_t, uint64_t >::const_iterator it = ja.cbegin(); it != ja.cend(); ++it, n++ ) {
+        if( it.key() <= prev ) {
+            std::cout << "push_back: keys out of order" << std::endl;
+            return false;
+        }
+        prev = it.key();
+    }
+    if( n != 100000 + 100 ) {
+        std::cout << "push_back: wrong number of keys, " << n << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// removing most keys shrinks the nodes; what is left must be intact
+bool testRemove() {
+    judyLArray< uint64_t, uint64_t > ja;
+    for( uint64_t i = 1; i <= 20000; i++ ) {
+        ja.insert( i * 2654435761u, i );
+    }
+    for( uint64_t i = 1; i <= 20000; i++ ) {
+        if( i % 97 && !ja.removeEntry( i * 2654435761u ) ) {
+            std::cout << "removeEntry: key " << i * 2654435761u << " not found" << std::endl;
+            return false;
+        }
+    }
+    uint64_t n = 0;
+    for( judyLArray< uint64_t, uint64_t >::const_iterator it = ja.cbegin(); it != ja.cend(); ++it, n++ ) {
+        if( it.value() % 97 || it.key() != it.value() * 2654435761u ) {
+            std::cout << "removeEntry: wrong key left, " << it.key() << std::endl;
+            return false;
+        }
+    }
+    if( n != 20000 / 97 || ja.find( uint64_t( 97 ) * 2654435761u ) != 97 ) {
+        std::cout << "removeEntry: wrong number of keys left, " << n << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// judy_slot and judy_strt can stop at an empty cell for key 0; it is not an entry
+bool testKeyZero() {
+    judyLArray< uint64_t, uint64_t > ja;
+    judyLArray< uint64_t, record > jr;
+    record r = { 1, 2, 3 };
+    for( uint64_t i = 1; i <= 3; i++ ) {
+        ja.insert( i, i * 10 );
+        jr.insert( i, r );
+    }
+    if( ja.removeEntry( 0 ) || jr.removeEntry( 0 ) || ja.findPtr( 0 ) || jr.findPtr( 0 ) ) {
+        std::cout << "key 0: found in an array without it" << std::endl;
+        return false;
+    }
+    if( ja.atOrAfter( 0 ).key != 1 || ja.getLastValue() != 10 || jr.atOrAfter( 0 ).value.a != 1 ) {
+        std::cout << "atOrAfter: stopped before the first key" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// dense levels use flat radix nodes; they must iterate both ways, and shrink away
+bool testDense() {
+    typedef judyLArray< uint64_t, uint64_t > jla;
+    jla ja;
+    for( uint64_t i = 1; i <= 30000; i++ ) {
+        ja.insert( i * 3, i );
+    }
+#ifdef JUDY_INSTRUMENT
+    if( !ja.counters().flattens ) {
+        std::cout << "dense: no radix node made flat" << std::endl;
+        return false;
+    }
+#endif
+    if( ja.find( 3 * 12345 ) != 12345 || ja.find( 3 * 12345 + 1 ) || ja.atOrAfter( 3 * 12345 + 1 ).value != 12346 ) {
+        std::cout << "dense: wrong value" << std::endl;
+        return false;
+    }
+    uint64_t n = 30000;
+    for( jla::const_iterator it = ja.cend(); it != ja.cbegin(); n-- ) {
+        --it;
+        if( it.key() != n * 3 ) {
+            std::cout << "dense: keys out of order going back, " << it.key() << std::endl;
+            return false;
+        }
+    }
+    for( uint64_t i = 1; i <= 30000; i++ ) {
+        if( i % 1000 && !ja.removeEntry( i * 3 ) ) {
+            std::cout << "dense: key " << i * 3 << " not removed" << std::endl;
+            return false;
+        }
+    }
+    for( jla::const_iterator it = ja.cbegin(); it != ja.cend(); ++it ) {
+        if( it.key() != ++n * 3000 ) {
+            std::cout << "dense: wrong key left, " << it.key() << std::endl;
+            return false;
+        }
+    }
+    return n == 30;
+}
+
+/// nodes of 40 children stay radix index nodes, and one of 49 is expanded
+bool testIndexed() {
+    typedef judyLArray< uint64_t, uint64_t > jla;
+    jla ja;
+    uint64_t n = 0;
+    for( uint64_t hi = 1; hi <= 40; hi++ ) {
+        for( uint64_t b = 0; b < ( hi == 20 ? 49u : 40u ); b++ ) {
+            ja.insert( hi << 56 | b * 5 << 48 | 7, ++n );
+        }
+    }
+#ifdef JUDY_INSTRUMENT
+    if( ja.counters().promotes[JUDY_radix] != 1 ) {
+        std::cout << "indexed: " << ja.counters().promotes[JUDY_radix] << " index nodes expanded, not 1" << std::endl;
+        return false;
+    }
+#endif
+    if( ja.find( 20ull << 56 | 240ull << 48 | 7 ) != 20 * 40 - 40 + 49 || ja.find( 21ull << 56 | 5ull << 48 | 7 ) != 20 * 40 + 9 + 2
+            || ja.find( 21ull << 56 | 5ull << 48 ) || ja.atOrAfter( 3ull << 56 | 6ull << 48 ).value != 2 * 40 + 3 ) {
+        std::cout << "indexed: wrong value" << std::endl;
+        return false;
+    }
+    for( jla::const_iterator it = ja.cend(); it != ja.cbegin(); n-- ) {
+        --it;
+        if( it.value() != n ) {
+            std::cout << "indexed: values out of order going back, " << it.value() << std::endl;
+            return false;
+        }
+    }
+    for( uint64_t hi = 1; hi <= 40; hi++ ) {
+        for( uint64_t b = 0; b < ( hi == 20 ? 49u : 40u ); b++ ) {
+            if( b % 10 && !ja.removeEntry( hi << 56 | b * 5 << 48 | 7 ) ) {
+                std::cout << "indexed: key not removed" << std::endl;
+                return false;
+            }
+        }
+    }
+    for( jla::const_iterator it = ja.cbegin(); it != ja.cend(); ++it ) {
+        if( ( it.key() >> 48 & 0xFF ) % 50 || ( it.key() & 0xFFFFFFFFFFFFull ) != 7 ) {
+            std::cout << "indexed: wrong key left, " << it.key() << std::endl;
+            return false;
+        }
+        n++;
+    }
+    if( n != 40 * 4 + 1 ) {
+        std::cout << "indexed: " << n << " keys left" << std::endl;
+        return false;
+    }
+    // keys added after deletes that leave the index node in place take the cells freed
+    jla jb;
+    for( uint64_t b = 0; b < 40; b++ ) {
+        jb.insert( b * 5 << 48 | 7, b + 1 );
+    }
+    for( uint64_t b = 0; b < 40; b += 2 ) {
+        jb.removeEntry( b * 5 << 48 | 7 );
+    }
+    for( uint64_t b = 0; b < 40; b += 2 ) {
+        jb.insert( ( b * 5 + 2 ) << 48 | 7, b + 101 );
+    }
+    for( uint64_t b = 0; b < 40; b++ ) {
+        if( jb.find( ( b * 5 + ( b & 1 ? 0 : 2 ) ) << 48 | 7 ) != b + ( b & 1 ? 1 : 101 ) ) {
+            std::cout << "indexed: wrong value in a freed cell" << std::endl;
+            return false;
+        }
+    }
+    n = 0;
+    for( jla::const_iterator it = jb.cbegin(); it != jb.cend(); ++it ) {
+        n++;
+    }
+    return n == 40;
+}
+
+#ifdef JUDY_INSTRUMENT
+/// each array counts its own lookups, inserts and node changes
+bool testCounters() {
+    judyLArray< uint64_t, uint64_t > ja;
+    for( uint64_t i = 1; i <= 1000; i++ ) {
+        ja.insert( i * 2654435761u, i );
+    }
+    ja.insert( 2654435761u, 5 );
+    ja.find( 2654435761u );
+    ja.find( 3 );
+    const JudyCounters & c = ja.counters();
+    unsigned long long descents = 0;
+    for( int i = 0; i <= JUDY_depths; i++ ) {
+        descents += c.depths[i];
+    }
+    if( c.inserts != 1000 || c.found != 1 || c.lookups != 2 || c.hits != 1 || descents != 1003 ) {
+        std::cout << "counters: wrong count of inserts or lookups" << std::endl;
+        return false;
+    }
+    if( !c.promotes[JUDY_32] || !c.splitnodes || !c.reuseMisses || !c.segments ) {
+        std::cout << "counters: node changes or allocations not counted" << std::endl;
+        return false;
+    }
+    return true;
+}
+#else
+bool testCounters() {
+    return true;
+}
+#endif
+
+/// adds up the values passed to it
+struct valueSum {
+    uint64_t * sum;
+    void operator()( uint64_t & v ) {
+        *sum += v;
+    }
+};
+
+/// iterators have cursors of their own and leave the array's state alone
+bool testIterators() {
+    typedef judyLArray< uint64_t, uint64_t > jla;
+    jla ja;
+    for( uint64_t i = 1; i <= 5000; i++ ) {
+        ja.insert( i, i * 10 );
+    }
+    ja.find( 77 );
+    uint64_t n = 0;
+    jla::const_iterator it = ja.cbegin(), other = ja.cbegin();
+    for( ; it != ja.cend(); ++it ) {
+        if( it.key() != ++n || it->value != n * 10 ) {
+            std::cout << "iterator: wrong pair at " << n << std::endl;
+            return false;
+        }
+    }
+    if( n != 5000 || other.key() != 1 || ja.getLastValue() != 770 ) {
+        std::cout << "iterator: cursors not independent" << std::endl;
+        return false;
+    }
+    for( it = ja.cend(); it != ja.cbegin(); ) {
+        --it;
+        if( it.key() != n-- ) {
+            std::cout << "iterator: wrong key in reverse at " << n + 1 << std::endl;
+            return false;
+        }
+    }
+    if( n || std::distance( ja.cbegin(), ja.cend() ) != 5000 ) {
+        std::cout << "iterator: wrong count in reverse" << std::endl;
+        return false;
+    }
+    for( jla::iterator i = ja.lower_bound( 4990 ); i != ja.cend(); i++ ) {
+        i.value() += 1;
+    }
+    if( ja.lower_bound( 5001 ) != ja.cend() || ja.upper_bound( 4990 ).key() != 4991 || ja.find( 4999 ) != 49991 ) {
+        std::cout << "lower_bound/upper_bound: wrong position" << std::endl;
+        return false;
+    }
+    // below the first key, judy_strt stops at an unused slot; it is not an entry
+    jla small;
+    for( uint64_t i = 1; i <= 3; i++ ) {
+        small.insert( i, i * 10 );
+    }
+    n = 0;
+    for( jla::iterator i = small.lower_bound( 0 ); i != small.cend(); ++i ) {
+        n++;
+    }
+    if( n != 3 || small.lower_bound( 0 ).key() != 1 || small.lower_bound( 0 ).value() != 10 || small.upper_bound( 0 ).key() != 1 ) {
+        std::cout << "lower_bound: stopped below the first key" << std::endl;
+        return false;
+    }
+    // seeks resume from the iterator's position
+    it = ja.cbegin();
+    for( n = 3; n <= 5000; n += 7 ) {
+        if( it.seek( n ).key() != n ) {
+            std::cout << "seek: wrong key for " << n << std::endl;
+            return false;
+        }
+    }
+    if( it.seek( 300 ).key() != 300 || it.seek( 5001 ) != ja.cend() || it.seek( 0 ).key() != 1 ) {
+        std::cout << "seek: wrong position seeking back or past the end" << std::endl;
+        return false;
+    }
+    // seeks below the first key, and just past a deleted one, land on entries
+    jla::const_iterator sit = small.cbegin();
+    ++sit;
+    if( sit.seek( 0 ).key() != 1 || sit.seek( 0 ).value() != 10 ) {
+        std::cout << "seek: stopped below the first key" << std::endl;
+        return false;
+    }
+    small.insert( 4, 40 );
+    small.insert( 5, 50 );
+    small.removeEntry( 2 );
+    small.removeEntry( 4 );
+    sit = small.cbegin();
+    if( sit.seek( 2 ).key() != 3 || sit.seek( 4 ).key() != 5 || sit.seek( 0 ).key() != 1 || sit.seek( 6 ) != small.cend() ) {
+        std::cout << "seek: wrong key past a deleted one" << std::endl;
+        return false;
+    }
+    // value-only traversal
+    uint64_t sum = 0, expected = 5000 * 5001 / 2 * 10 + 11;
+    for( uint64_t * p = ja.firstValue(); p; p = ja.nextValue() ) {
+        sum += *p;
+    }
+    valueSum f = { &n };
+    n = 0;
+    ja.forEachValue( f );
+    if( sum != expected || n != expected ) {
+        std::cout << "firstValue/nextValue/forEachValue: wrong sum of values" << std::endl;
+        return false;
+    }
+#ifdef HAVE_STD_ENABLEIF
+    n = 0;
+    for( const auto & kv : ja.items() ) {
+        n += kv.key;
+    }
+    if( n != 5000 * 5001 / 2 ) {
+        std::cout << "items: wrong sum of keys" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
 int main() {
     std::cout.setf( std::ios::boolalpha );
     judyLArray< uint64_t, uint64_t > jl;
@@ -28,6 +461,10 @@ int main() {
 
     jl.clear();
 
+    if( !testRecords() || !testCopyMove() || !testIterators() || !testPushBack() || !testRemove() || !testKeyZero() || !testDense() || !testIndexed() || !testCounters() ) {
+        exit( EXIT_FAILURE );
+    }
+
     //TODO test all of judyLArray
     exit( EXIT_SUCCESS );
 }
\ No newline at end of file
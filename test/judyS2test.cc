@@ -1,6 +1,9 @@
 #include <iostream>
 #include <stdint.h>
 #include <stdlib.h>
+#include <iterator>
+#include <string.h>
+#include <string>
 
 #include "judyS2Array.h"
 
@@ -19,7 +22,7 @@ bool testFind( js2a & j, const char * key, unsigned int count ) {
             return false;
         } else {
             // note - this doesn't verify that the right keys are returned, just the right number!
-            js2a::vector::const_iterator it = v->begin();
+            js2a::cvector::const_iterator it = v->begin();
             std::cout << "    correct number of values -";
             for( ; it != v->end(); it++ ) {
                 std::cout << " " << *it;
@@ -62,6 +65,85 @@ int main() {
     pass &= testFind( js, "bah",  1 );
     pass &= testFind( js, "blh",  2 );
 
+    // more values than are stored inline
+    for( uint64_t i = 0; i < 20; i++ ) {
+        js.insert( "blh", 1000 + i );
+    }
+    pass &= testFind( js, "blh",  22 );
+    js2a::vector values( 3, 42 );
+    js.insert( "blh", values, 0, true );
+    pass &= testFind( js, "blh",  3 );
+    pass &= ( js.removeEntry( "blh" ) && testFind( js, "blh", 0 ) );
+
+    // the empty key is absent, although judy_slot can stop at an empty cell for it
+    if( js.removeEntry( "" ) ) {
+        std::cout << "empty key: found in an array without it" << std::endl;
+        pass = false;
+    }
+    pass &= testFind( js, "", 0 );
+
+    // copies are deep; swap and move hand over the contents
+    for( uint64_t i = 0; i < 20; i++ ) {
+        js.insert( "many", i );
+    }
+    js2a jc( js );
+    jc.insert( "many", 20 );
+    jc.removeEntry( "bah" );
+    pass &= testFind( js, "many", 20 ) && testFind( js, "bah", 1 ) && testFind( jc, "many", 21 );
+    js2a jd( 16 );
+    jd = jc;
+    jd.swap( js );
+    pass &= testFind( js, "bah", 0 ) && testFind( jd, "bah", 1 );
+#ifdef HAVE_STD_ENABLEIF
+    js2a jm( std::move( jd ) );
+    jd = std::move( jm );
+    pass &= testFind( jd, "many", 20 );
+#endif
+
+    // iterators have cursors of their own and leave the array's state alone
+    js2a::const_iterator it = js.cbegin();
+    js2a::const_iterator last = js.cend();
+    --last;
+    if( strcmp( it.key(), "bh" ) || it->value->at( 0 ) != 234 || strcmp( last.key(), "many" ) || last.value().size() != 21 ) {
+        std::cout << "iterator: wrong first or last pair" << std::endl;
+        pass = false;
+    }
+    if( strcmp( js.lower_bound( "bm" ).key(), "many" ) || strcmp( js.upper_bound( "bla" ).key(), "blah" ) || js.upper_bound( "many" ) != js.cend() ) {
+        std::cout << "lower_bound/upper_bound: wrong position" << std::endl;
+        pass = false;
+    }
+
+    // keys given with a length need not be NUL-terminated
+    const char * buffer = "blahbla";
+    pass &= testFind( js, "bla", 1 );
+    js.insert( judyStringKey( buffer + 4, 3 ), 7 );
+    js.insert( std::string( "bla" ), values );
+    if( js.find( judyStringKey( buffer, 3 ) )->size() != 5 || !js.removeEntry( buffer, 3 ) ) {
+        std::cout << "insert: wrong values for a key with a length" << std::endl;
+        pass = false;
+    }
+
+    // value-only traversal
+    size_t count = 0, keys = 0;
+    for( js2a::cvector * vs = js.firstValue(); vs; vs = js.nextValue() ) {
+        count += vs->size();
+        keys++;
+    }
+#ifdef HAVE_STD_ENABLEIF
+    size_t count2 = 0;
+    js.forEachValue( [&count2]( js2a::cvector & vs ) {
+        count2 += vs.size();
+    } );
+    if( count2 != count ) {
+        std::cout << "forEachValue: wrong number of values" << std::endl;
+        pass = false;
+    }
+#endif
+    if( keys != ( size_t ) std::distance( js.cbegin(), js.cend() ) ) {
+        std::cout << "firstValue/nextValue: wrong number of keys" << std::endl;
+        pass = false;
+    }
+
     js.clear();
 
     //TODO test all of judyS2Array
@@ -1,9 +1,16 @@
 #include <iostream>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
 
 #include "judySArray.h"
 
+struct record {
+    uint64_t a, b, c;
+};
+
 int main() {
     bool pass = true;
     std::cout.setf( std::ios::boolalpha );
@@ -31,6 +38,158 @@ int main() {
         pass = false;
     }
 
+    judySArray< record > jr( 255 );
+    record r = { 1, 2, 3 };
+    jr.insert( "blah", r );
+    r.a = 4;
+    jr.insert( "bah", r );
+    record * p = jr.findPtr( "blah" );
+    if( !p || p->a != 1 || p->c != 3 || jr.find( "bah" ).a != 4 ) {
+        std::cout << "findPtr: wrong record for key blah" << std::endl;
+        pass = false;
+    }
+    if( !jr.removeEntry( "bah" ) || jr.findPtr( "bah" ) ) {
+        std::cout << "removeEntry: record for key bah not removed" << std::endl;
+        pass = false;
+    }
+    if( jr.removeEntry( "" ) || jr.findPtr( "" ) || js.removeEntry( "" ) || js.findPtr( "" ) ) {
+        std::cout << "empty key: found in an array without it" << std::endl;
+        pass = false;
+    }
+
+    // copies are deep; swap exchanges the contents
+    judySArray< record > jc( jr );
+    jc.findPtr( "blah" )->a = 5;
+    jc.insert( "bah", r );
+    if( jr.find( "blah" ).a != 1 || jr.findPtr( "bah" ) || jc.find( "blah" ).a != 5 ) {
+        std::cout << "copy: not a deep copy" << std::endl;
+        pass = false;
+    }
+    jr.swap( jc );
+    if( jr.find( "blah" ).a != 5 || jc.findPtr( "bah" ) ) {
+        std::cout << "swap: contents not exchanged" << std::endl;
+        pass = false;
+    }
+    judySArray< uint64_t > jk( 4 );
+    jk.insert( "abcd", 1 );
+    jk = judySArray< uint64_t >( jk );
+    if( jk.find( "abcd" ) != 1 ) {
+        std::cout << "copy: key of maximum length not copied" << std::endl;
+        pass = false;
+    }
+#ifdef HAVE_STD_ENABLEIF
+    judySArray< record > jm( std::move( jr ) );
+    jr = std::move( jm );
+    if( jr.find( "blah" ).a != 5 ) {
+        std::cout << "move: contents lost" << std::endl;
+        pass = false;
+    }
+    if( jm.begin().key[0] || jm.success() || !jm.isEmpty() || jm.findPtr( "blah" ) || jm.cbegin() != jm.cend() ) {
+        std::cout << "move: moved-from array not empty" << std::endl;
+        pass = false;
+    }
+    jm.insert( "x", r );
+    if( !jm.findPtr( "x" ) || jm.begin().value.a != r.a ) {
+        std::cout << "move: moved-from array not usable" << std::endl;
+        pass = false;
+    }
+#endif
+
+    // iterators have cursors of their own and leave the array's state alone
+    typedef judySArray< uint64_t >::const_iterator sit;
+    js.find( "bah" );
+    const char * order[] = { "bah", "bh", "bla", "blah", "blh" };
+    unsigned int n = 0;
+    for( sit it = js.cbegin(); it != js.cend(); it++, n++ ) {
+        if( n > 4 || strcmp( it.key(), order[n] ) || strcmp( ( const char * ) it->key, order[n] ) ) {
+            std::cout << "iterator: wrong key at " << n << std::endl;
+            pass = false;
+            break;
+        }
+    }
+    if( n != 5 ) {
+        std::cout << "iterator: wrong count, " << n << std::endl;
+        pass = false;
+    }
+    for( sit it = js.cend(); it != js.cbegin(); ) {
+        --it;
+        if( !n-- || strcmp( it.key(), order[n] ) ) {
+            std::cout << "iterator: wrong key in reverse at " << n << std::endl;
+            pass = false;
+            break;
+        }
+    }
+    if( n != 0 ) {
+        std::cout << "iterator: wrong count in reverse, " << 5 - n << std::endl;
+        pass = false;
+    }
+    sit last = js.cend();
+    --last;
+    if( strcmp( last.key(), "blh" ) || js.getLastValue() != 124 ) {
+        std::cout << "iterator: array state changed" << std::endl;
+        pass = false;
+    }
+    if( strcmp( js.lower_bound( "bl" ).key(), "bla" ) || strcmp( js.upper_bound( "bla" ).key(), "blah" ) || js.upper_bound( "blh" ) != js.cend() ) {
+        std::cout << "lower_bound/upper_bound: wrong position" << std::endl;
+        pass = false;
+    }
+    sit seeker = js.cbegin();
+    if( strcmp( seeker.seek( "bb" ).key(), "bh" ) || strcmp( seeker.seek( "blah" ).key(), "blah" ) ||
+            strcmp( seeker.seek( "ba" ).key(), "bah" ) || seeker.seek( "bz" ) != js.cend() ||
+            strcmp( seeker.seek( "" ).key(), "bah" ) || strcmp( seeker.seek( "blh" ).seek( "a" ).key(), "bah" ) ) {
+        std::cout << "seek: wrong position" << std::endl;
+        pass = false;
+    }
+    judySArray< uint64_t > sorted( 16 );
+    char name[16];
+    for( unsigned int i = 0; i < 3000; i += 3 ) {
+        sprintf( name, "log/%04u/%u", i / 100, i );
+        sorted.push_back( name, i + 1 );
+    }
+    sorted.push_back( "log/0000/1", 2 );
+    if( sorted.find( "log/0029/2997" ) != 2998 || sorted.find( "log/0000/1" ) != 2 || sorted.find( "log/0012/1200" ) != 1201 ) {
+        std::cout << "push_back: wrong value" << std::endl;
+        pass = false;
+    }
+    // value-only traversal
+    uint64_t sum = 0;
+    for( uint64_t * pv = js.firstValue(); pv; pv = js.nextValue() ) {
+        sum += *pv;
+    }
+    if( sum != 1234 + 124 + 123 + 134 + 234 ) {
+        std::cout << "firstValue/nextValue: wrong sum of values" << std::endl;
+        pass = false;
+    }
+#ifdef HAVE_STD_ENABLEIF
+    n = 0;
+    for( const auto & item : js.items() ) {
+        n += item.value;
+    }
+    if( n != 1234 + 124 + 123 + 134 + 234 ) {
+        std::cout << "items: wrong sum of values" << std::endl;
+        pass = false;
+    }
+#endif
+
+    // keys given with a length need not be NUL-terminated
+    const char * buffer = "blahblhbah";
+    std::string bah( "bah" );
+    if( js.find( judyStringKey( buffer, 4 ) ) != 1234 || js.find( buffer + 4, 3 ) != 123 || js.find( bah ) != 124 ) {
+        std::cout << "find: wrong value for a key with a length" << std::endl;
+        pass = false;
+    }
+    js.insert( judyStringKey( buffer + 4, 2 ), 42 );
+    if( js.find( "bl" ) != 42 || js.upper_bound( "bl" ).keyView() != judyStringKey( "bla" ) || !js.removeEntry( buffer + 4, 2 ) ) {
+        std::cout << "insert: wrong key for a key with a length" << std::endl;
+        pass = false;
+    }
+#ifdef HAVE_STD_STRING_VIEW
+    std::string_view view( buffer, 3 );
+    if( js.find( view ) != 134 || std::string_view( js.lower_bound( view ).keyView() ) != "bla" ) {
+        std::cout << "find: wrong value for a std::string_view key" << std::endl;
+        pass = false;
+    }
+#endif
 
     //TODO test all of judySArray
     if( pass ) {